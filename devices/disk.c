@@ -2,11 +2,17 @@
 #include <ctype.h>
 #include <debug.h>
 #include <stdbool.h>
+#include <list.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -32,6 +38,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +54,48 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Bus master IDE registers, relative to a channel's bm_base.
+   See the Intel 82371 (PIIX) datasheet, section 2.7. */
+#define reg_bm_cmd(CHANNEL) ((CHANNEL)->bm_base + 0)    /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2) /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)   /* PRD table addr. */
+
+/* Bus master command register bits. */
+#define BM_CMD_START 0x01       /* Start/stop bus master transfer. */
+#define BM_CMD_READ 0x08        /* 1=write to memory (disk read). */
+
+/* Bus master status register bits. */
+#define BM_STA_ERR 0x02         /* Transfer failed (write 1 to clear). */
+#define BM_STA_IRQ 0x04         /* Device raised IRQ (write 1 to clear). */
+
+/* Physical Region Descriptor, one piece of a scatter-gather
+   DMA transfer.  A PRD must not cross a 64 kB boundary. */
+struct prd {
+	uint32_t addr;              /* Physical address of buffer. */
+	uint16_t size;              /* Byte count; 0 means 64 kB. */
+	uint16_t flags;             /* PRD_EOT on the last entry. */
+};
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Largest transfer issued as a single DMA command, in sectors.
+   Requests larger than this are split. */
+#define DMA_MAX_SECTORS 128
+
+/* How long a request may wait in a channel's queue, in timer
+   ticks, before the elevator serves it out of order.  Reads get
+   a shorter deadline because a thread is usually blocked on
+   them. */
+#define READ_DEADLINE (TIMER_FREQ / 10)
+#define WRITE_DEADLINE (TIMER_FREQ / 2)
+
+/* PCI configuration space access, used to locate the IDE
+   controller's bus master registers. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+#define PCI_CMD_BUS_MASTER 0x04 /* Command register: bus master enable. */
 
 /* An ATA device. */
 struct disk {
@@ -55,24 +104,56 @@ struct disk {
 	int dev_no;                 /* Device 0 or 1 for master or slave. */
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
+	bool dma;                   /* 1=Transfers use bus master DMA. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
 };
 
+/* A transfer waiting in a channel's queue.  Lives on the stack
+   of the thread that submitted it, which sleeps on DONE until the
+   channel's worker thread has carried it out. */
+struct disk_request {
+	struct list_elem elem;      /* In channel's queue, or in a batch. */
+	struct list_elem fifo_elem; /* In channel's fifo. */
+	struct disk *disk;          /* Target disk. */
+	disk_sector_t sec_no;       /* First sector. */
+	size_t cnt;                 /* Number of sectors. */
+	void *buffer;               /* Kernel buffer, CNT sectors long. */
+	bool read;                  /* True to read, false to write. */
+	int64_t deadline;           /* Timer tick by which to serve it. */
+	struct semaphore done;      /* Up'd when the transfer completes. */
+};
+
 /* An ATA channel (aka controller).
-   Each channel can control up to two disks. */
+   Each channel can control up to two disks.
+
+   Once disk_init() returns, only the channel's worker thread
+   touches the controller.  Other threads queue disk_requests and
+   wait for the worker to serve them. */
 struct channel {
 	char name[8];               /* Name, e.g. "hd0". */
 	uint16_t reg_base;          /* Base I/O port. */
 	uint8_t irq;                /* Interrupt in use. */
 
-	struct lock lock;           /* Must acquire to access the controller. */
+	struct lock lock;           /* Protects the request queue. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+	uint16_t bm_base;           /* Bus master I/O port, 0 if no DMA. */
+	struct prd *prdt;           /* PRD table, one page, if bm_base. */
+
+	struct lock bounce_lock;    /* Protects bounce. */
+	uint8_t *bounce;            /* One page for user buffers. */
+
+	struct list queue;          /* Pending requests, by device and sector. */
+	struct list fifo;           /* Pending requests, oldest first. */
+	struct condition work;      /* Signaled when a request is queued. */
+	int head_dev;               /* Elevator position: device... */
+	disk_sector_t head_sec;     /* ...and sector after the last served. */
+
 	struct disk devices[2];     /* The devices on this channel. */
 };
 
@@ -84,11 +165,18 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
+static uint16_t find_bus_master (void);
+static void channel_worker (void *);
+static bool request_less (const struct list_elem *, const struct list_elem *,
+		void *aux);
+static void pio_transfer (struct disk_request *);
+static void dma_transfer (struct list *batch);
+
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
 static void select_device (const struct disk *);
@@ -100,6 +188,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 disk_init (void) {
 	size_t chan_no;
+	uint16_t bm_base = find_bus_master ();
 
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
@@ -122,6 +211,23 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		list_init (&c->queue);
+		list_init (&c->fifo);
+		cond_init (&c->work);
+		c->head_dev = 0;
+		c->head_sec = 0;
+		lock_init (&c->bounce_lock);
+		c->bounce = palloc_get_page (PAL_ASSERT);
+
+		/* Each channel has its own 8-byte block of bus master
+		   registers and its own PRD table. */
+		c->bm_base = 0;
+		c->prdt = NULL;
+		if (bm_base != 0) {
+			c->prdt = palloc_get_page (0);
+			if (c->prdt != NULL)
+				c->bm_base = bm_base + chan_no * 8;
+		}
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -131,6 +237,7 @@ disk_init (void) {
 			d->dev_no = dev_no;
 
 			d->is_ata = false;
+			d->dma = false;
 			d->capacity = 0;
 
 			d->read_cnt = d->write_cnt = 0;
@@ -150,6 +257,12 @@ disk_init (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
+
+		/* From here on the worker owns the controller.  It runs at
+		   top priority so that queued I/O is not stuck behind
+		   whatever the submitters are competing with. */
+		if (c->devices[0].is_ata || c->devices[1].is_ata)
+			thread_create (c->name, PRI_MAX, channel_worker, c);
 	}
 
 	/* DO NOT MODIFY BELOW LINES. */
@@ -209,21 +322,7 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
-
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_sectors (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -233,23 +332,451 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	disk_write_sectors (d, sec_no, buffer, 1);
+}
+
+/* Initializes R as a transfer of CNT sectors starting at SEC_NO
+   between disk D and kernel buffer BUFFER and adds it to D's
+   channel queue.  The caller must hold the channel lock and
+   signal the worker. */
+static void
+queue_request (struct disk_request *r, struct disk *d, disk_sector_t sec_no,
+		void *buffer, size_t cnt, bool read) {
+	struct channel *c = d->channel;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+	ASSERT (is_kernel_vaddr (buffer));
+	ASSERT (cnt > 0);
+
+	r->disk = d;
+	r->sec_no = sec_no;
+	r->cnt = cnt;
+	r->buffer = buffer;
+	r->read = read;
+	r->deadline = timer_ticks () + (read ? READ_DEADLINE : WRITE_DEADLINE);
+	sema_init (&r->done, 0);
+
+	list_insert_ordered (&c->queue, &r->elem, request_less, NULL);
+	list_push_back (&c->fifo, &r->fifo_elem);
+}
+
+/* Queues a transfer of CNT sectors starting at SEC_NO between
+   disk D and kernel buffer BUFFER on D's channel and waits for the
+   channel's worker to complete it. */
+static void
+submit_request (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt, bool read) {
+	struct channel *c = d->channel;
+	struct disk_request r;
+
+	lock_acquire (&c->lock);
+	queue_request (&r, d, sec_no, buffer, cnt, read);
+	cond_signal (&c->work, &c->lock);
+	lock_release (&c->lock);
+
+	sema_down (&r.done);
+}
+
+/* Reads or writes CNT sectors starting at SEC_NO on disk D,
+   splitting the transfer into requests no larger than one DMA
+   command.  The worker thread runs without the caller's page
+   table, so a user BUFFER is bounced a page at a time through the
+   channel's bounce page here, in the caller's context. */
+static void
+transfer (struct disk *d, disk_sector_t sec_no, void *buffer, size_t cnt,
+		bool read) {
+	uint8_t *p = buffer;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
-	c = d->channel;
+	if (is_kernel_vaddr (buffer)) {
+		while (cnt > 0) {
+			size_t n = cnt < DMA_MAX_SECTORS ? cnt : DMA_MAX_SECTORS;
+			submit_request (d, sec_no, p, n, read);
+			sec_no += n;
+			p += n * DISK_SECTOR_SIZE;
+			cnt -= n;
+		}
+	} else {
+		struct channel *c = d->channel;
+
+		lock_acquire (&c->bounce_lock);
+		while (cnt > 0) {
+			size_t n = cnt < PGSIZE / DISK_SECTOR_SIZE
+				? cnt : PGSIZE / DISK_SECTOR_SIZE;
+			if (!read)
+				memcpy (c->bounce, p, n * DISK_SECTOR_SIZE);
+			submit_request (d, sec_no, c->bounce, n, read);
+			if (read)
+				memcpy (p, c->bounce, n * DISK_SECTOR_SIZE);
+			sec_no += n;
+			p += n * DISK_SECTOR_SIZE;
+			cnt -= n;
+		}
+		lock_release (&c->bounce_lock);
+	}
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  The request joins the channel's queue, where it may be
+   reordered and merged with neighbouring requests from other
+   threads; this returns once its data has arrived.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_sectors (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt) {
+	transfer (d, sec_no, buffer, cnt, true);
+}
+
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   Queued as in disk_read_sectors().  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_sectors (struct disk *d, disk_sector_t sec_no, const void *buffer,
+		size_t cnt) {
+	transfer (d, sec_no, (void *) buffer, cnt, false);
+}
+
+/* Reads or writes the sectors starting at SEC_NO on disk D from
+   or into the SEG_CNT buffers in SEGS, in order.  All the pieces
+   are queued together, so the worker sees them at once and can
+   merge them into a single scatter-gather command. */
+static void
+transfer_segments (struct disk *d, disk_sector_t sec_no,
+		const struct disk_segment *segs, size_t seg_cnt, bool read) {
+	struct channel *c = d->channel;
+	struct disk_request *reqs;
+	size_t i;
+
+	ASSERT (d != NULL);
+
+	reqs = malloc (seg_cnt * sizeof *reqs);
+	if (reqs == NULL) {
+		/* Out of memory: one piece at a time still works. */
+		for (i = 0; i < seg_cnt; i++) {
+			transfer (d, sec_no, segs[i].buffer, segs[i].cnt, read);
+			sec_no += segs[i].cnt;
+		}
+		return;
+	}
+
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
+	for (i = 0; i < seg_cnt; i++) {
+		ASSERT (segs[i].cnt <= DMA_MAX_SECTORS);
+		queue_request (&reqs[i], d, sec_no, segs[i].buffer, segs[i].cnt, read);
+		sec_no += segs[i].cnt;
+	}
+	cond_signal (&c->work, &c->lock);
 	lock_release (&c->lock);
+
+	for (i = 0; i < seg_cnt; i++)
+		sema_down (&reqs[i].done);
+	free (reqs);
 }
-
+
+/* Reads consecutive sectors starting at SEC_NO from disk D into
+   the SEG_CNT kernel buffers described by SEGS, filling each in
+   turn.  Each segment may hold at most 128 sectors.  Lets a
+   caller whose memory is not virtually contiguous, such as a set
+   of user frames, read a disk extent in one command. */
+void
+disk_read_segments (struct disk *d, disk_sector_t sec_no,
+		const struct disk_segment *segs, size_t seg_cnt) {
+	transfer_segments (d, sec_no, segs, seg_cnt, true);
+}
+
+/* Writes consecutive sectors starting at SEC_NO to disk D from
+   the SEG_CNT kernel buffers described by SEGS, as
+   disk_read_segments(). */
+void
+disk_write_segments (struct disk *d, disk_sector_t sec_no,
+		const struct disk_segment *segs, size_t seg_cnt) {
+	transfer_segments (d, sec_no, segs, seg_cnt, false);
+}
+
+/* Request scheduling. */
+
+/* Orders disk_requests by device, then by sector. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct disk_request *a = list_entry (a_, struct disk_request, elem);
+	const struct disk_request *b = list_entry (b_, struct disk_request, elem);
+
+	if (a->disk->dev_no != b->disk->dev_no)
+		return a->disk->dev_no < b->disk->dev_no;
+	return a->sec_no < b->sec_no;
+}
+
+/* Returns true if the CNT sectors at BUFFER can be moved by bus
+   master DMA on disk D.  The controller takes 32-bit physical
+   addresses. */
+static bool
+can_dma (const struct disk *d, const void *buffer, size_t cnt) {
+	return d->dma && vtop (buffer) + cnt * DISK_SECTOR_SIZE <= UINT32_MAX;
+}
+
+/* Chooses the next requests for channel C to serve, removes them
+   from C's queue and appends them to BATCH.
+
+   The oldest request goes first if it has passed its deadline.
+   Otherwise the elevator continues its upward sweep from where
+   the last transfer ended (C-LOOK), wrapping around to the lowest
+   pending sector when nothing lies ahead.  Requests that continue
+   the chosen one on the same disk, in the same direction, are
+   merged into the batch as long as the whole batch fits in one
+   DMA command. */
+static void
+pick_requests (struct channel *c, struct list *batch) {
+	struct disk_request *r, *oldest;
+	struct list_elem *e;
+	disk_sector_t end;
+	size_t cnt;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+	ASSERT (!list_empty (&c->queue));
+
+	oldest = list_entry (list_front (&c->fifo), struct disk_request, fifo_elem);
+	if (timer_ticks () >= oldest->deadline)
+		r = oldest;
+	else {
+		for (e = list_begin (&c->queue); e != list_end (&c->queue);
+				e = list_next (e)) {
+			r = list_entry (e, struct disk_request, elem);
+			if (r->disk->dev_no > c->head_dev
+					|| (r->disk->dev_no == c->head_dev && r->sec_no >= c->head_sec))
+				break;
+		}
+		if (e == list_end (&c->queue))
+			e = list_begin (&c->queue);
+		r = list_entry (e, struct disk_request, elem);
+	}
+
+	/* Take R, then whatever follows it contiguously. */
+	end = r->sec_no + r->cnt;
+	cnt = r->cnt;
+	e = list_next (&r->elem);
+	list_remove (&r->elem);
+	list_remove (&r->fifo_elem);
+	list_push_back (batch, &r->elem);
+
+	if (can_dma (r->disk, r->buffer, r->cnt))
+		while (e != list_end (&c->queue)) {
+			struct disk_request *next = list_entry (e, struct disk_request, elem);
+
+			if (next->disk != r->disk || next->read != r->read
+					|| next->sec_no != end
+					|| cnt + next->cnt > DMA_MAX_SECTORS
+					|| !can_dma (next->disk, next->buffer, next->cnt))
+				break;
+			e = list_next (e);
+			list_remove (&next->elem);
+			list_remove (&next->fifo_elem);
+			list_push_back (batch, &next->elem);
+			end += next->cnt;
+			cnt += next->cnt;
+		}
+
+	c->head_dev = r->disk->dev_no;
+	c->head_sec = end;
+}
+
+/* Body of a channel's worker thread.  Serves the queue of channel
+   C_ forever, one batch per ATA command, and wakes the threads
+   whose requests complete. */
+static void
+channel_worker (void *c_) {
+	struct channel *c = c_;
+
+	for (;;) {
+		struct list batch;
+		struct disk_request *r;
+
+		list_init (&batch);
+		lock_acquire (&c->lock);
+		while (list_empty (&c->queue))
+			cond_wait (&c->work, &c->lock);
+		pick_requests (c, &batch);
+		lock_release (&c->lock);
+
+		r = list_entry (list_front (&batch), struct disk_request, elem);
+		if (can_dma (r->disk, r->buffer, r->cnt))
+			dma_transfer (&batch);
+		else
+			pio_transfer (r);
+
+		while (!list_empty (&batch)) {
+			r = list_entry (list_pop_front (&batch), struct disk_request, elem);
+			sema_up (&r->done);
+		}
+	}
+}
+
+/* Carries out request R one sector at a time by programmed I/O. */
+static void
+pio_transfer (struct disk_request *r) {
+	struct disk *d = r->disk;
+	struct channel *c = d->channel;
+	uint8_t *p = r->buffer;
+	size_t i;
+
+	for (i = 0; i < r->cnt; i++, p += DISK_SECTOR_SIZE) {
+		disk_sector_t sec_no = r->sec_no + i;
+
+		select_sector (d, sec_no, 1);
+		if (r->read) {
+			issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+			sema_down (&c->completion_wait);
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+			input_sector (c, p);
+			d->read_cnt++;
+		} else {
+			issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+			output_sector (c, p);
+			sema_down (&c->completion_wait);
+			d->write_cnt++;
+		}
+	}
+}
+
+/* Bus master DMA. */
+
+/* Reads the 32-bit PCI configuration register at OFFSET of
+   function FUNC of device DEV on bus BUS. */
+static uint32_t
+pci_read_config (int bus, int dev, int func, int offset) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11)
+			| (func << 8) | (offset & 0xfc));
+	return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit PCI configuration register at
+   OFFSET of function FUNC of device DEV on bus BUS. */
+static void
+pci_write_config (int bus, int dev, int func, int offset, uint32_t value) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11)
+			| (func << 8) | (offset & 0xfc));
+	outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller that advertises bus
+   master capability, such as the PIIX found in QEMU, enables bus
+   mastering on it, and returns the I/O base of its bus master
+   registers.  Returns 0 if there is none, in which case all
+   transfers use PIO. */
+static uint16_t
+find_bus_master (void) {
+	int dev, func;
+
+	for (dev = 0; dev < 32; dev++)
+		for (func = 0; func < 8; func++) {
+			uint32_t id = pci_read_config (0, dev, func, 0x00);
+			uint32_t class, bar4, cmd;
+
+			if ((id & 0xffff) == 0xffff)
+				continue;
+
+			/* Class 01h (mass storage), subclass 01h (IDE), with
+			   programming interface bit 7 (bus master capable). */
+			class = pci_read_config (0, dev, func, 0x08);
+			if ((class >> 16) != 0x0101 || !(class & 0x8000))
+				continue;
+
+			/* BAR4 holds the bus master I/O base. */
+			bar4 = pci_read_config (0, dev, func, 0x20);
+			if (!(bar4 & 1) || (bar4 & 0xfffc) == 0)
+				continue;
+
+			/* Enable bus mastering.  Only the low half (command)
+			   is written back; writing ones to the status half
+			   would clear its sticky bits. */
+			cmd = pci_read_config (0, dev, func, 0x04);
+			pci_write_config (0, dev, func, 0x04,
+					(cmd & 0xffff) | PCI_CMD_BUS_MASTER);
+			return bar4 & 0xfffc;
+		}
+	return 0;
+}
+
+/* Carries out the requests in BATCH, which are contiguous on one
+   disk and all in one direction, as a single bus master DMA
+   command.  Each request's buffer becomes one or more PRDs, so
+   the buffers need not be physically contiguous, or even
+   adjacent to one another. */
+static void
+dma_transfer (struct list *batch) {
+	struct disk_request *first =
+		list_entry (list_front (batch), struct disk_request, elem);
+	struct disk *d = first->disk;
+	struct channel *c = d->channel;
+	bool read = first->read;
+	disk_sector_t sec_no = first->sec_no;
+	struct list_elem *e;
+	size_t cnt = 0;
+	size_t n = 0;
+	uint8_t bm_status, status;
+
+	/* Build the PRD table.  Splitting at page boundaries also keeps
+	   every PRD inside a single 64 kB region. */
+	for (e = list_begin (batch); e != list_end (batch); e = list_next (e)) {
+		struct disk_request *r = list_entry (e, struct disk_request, elem);
+		uint8_t *p = r->buffer;
+		size_t left = r->cnt * DISK_SECTOR_SIZE;
+
+		while (left > 0) {
+			size_t chunk = PGSIZE - pg_ofs (p);
+			if (chunk > left)
+				chunk = left;
+			c->prdt[n].addr = vtop (p);
+			c->prdt[n].size = chunk;
+			c->prdt[n].flags = 0;
+			n++;
+			p += chunk;
+			left -= chunk;
+		}
+		cnt += r->cnt;
+	}
+	c->prdt[n - 1].flags = PRD_EOT;
+	ASSERT (cnt > 0 && cnt <= DMA_MAX_SECTORS);
+
+	/* Stop any previous transfer, point the controller at the
+	   table, clear stale status, and set the direction. */
+	outb (reg_bm_cmd (c), 0);
+	outl (reg_bm_prdt (c), vtop (c->prdt));
+	outb (reg_bm_status (c), inb (reg_bm_status (c)) | BM_STA_ERR | BM_STA_IRQ);
+	outb (reg_bm_cmd (c), read ? BM_CMD_READ : 0);
+
+	/* Issue the ATA command, then start the engine. */
+	select_sector (d, sec_no, cnt);
+	issue_pio_command (c, read ? CMD_READ_DMA : CMD_WRITE_DMA);
+	outb (reg_bm_cmd (c), (read ? BM_CMD_READ : 0) | BM_CMD_START);
+
+	sema_down (&c->completion_wait);
+
+	/* Stop the engine and check both status registers. */
+	outb (reg_bm_cmd (c), 0);
+	bm_status = inb (reg_bm_status (c));
+	outb (reg_bm_status (c), bm_status | BM_STA_ERR | BM_STA_IRQ);
+	status = inb (reg_alt_status (c));
+	if ((bm_status & BM_STA_ERR) || (status & STA_ERR))
+		PANIC ("%s: DMA %s failed, sector=%"PRDSNu, d->name,
+				read ? "read" : "write", sec_no);
+
+	if (read)
+		d->read_cnt += cnt;
+	else
+		d->write_cnt += cnt;
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -364,6 +891,10 @@ identify_ata_device (struct disk *d) {
 	/* Calculate capacity. */
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+	/* Word 49 bit 8: DMA supported.  Use it if the controller can
+	   master the bus. */
+	d->dma = c->bm_base != 0 && (id[49] & (1 << 8)) != 0;
+
 	/* Print identification message. */
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -402,17 +933,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt > 0 && cnt <= 256);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt == 256 ? 0 : cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
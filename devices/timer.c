@@ -7,6 +7,10 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/vdso.h"
+#endif
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 // TIMER_FREQ: timer interrupt 주파수.
@@ -18,6 +22,9 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* Number of ticks over which timer_calibrate() measures the TSC. */
+#define TSC_CALIBRATION_TICKS 4
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
@@ -25,6 +32,10 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of TSC cycles per timer tick.
+   Initialized by timer_calibrate(). */
+static uint64_t tsc_per_tick;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
@@ -50,6 +61,8 @@ timer_init (void) {
 void
 timer_calibrate (void) {
 	unsigned high_bit, test_bit;
+	int64_t start;
+	uint64_t tsc;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
@@ -68,9 +81,26 @@ timer_calibrate (void) {
 		if (!too_many_loops (high_bit | test_bit))
 			loops_per_tick |= test_bit;
 
+	/* Count TSC cycles over a few whole ticks. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	tsc = rdtsc ();
+	start = ticks;
+	while (ticks - start < TSC_CALIBRATION_TICKS)
+		barrier ();
+	tsc_per_tick = (rdtsc () - tsc) / TSC_CALIBRATION_TICKS;
+
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
+/* Returns the number of TSC cycles per timer tick, as measured by
+   timer_calibrate(). */
+uint64_t
+timer_tsc_per_tick (void) {
+	return tsc_per_tick;
+}
+
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) {
@@ -166,6 +196,9 @@ timer_interrupt (struct intr_frame *args UNUSED)
   }
   /*여기까지*/
   thread_awake (ticks);	//
+#ifdef USERPROG
+  vdso_tick (ticks);
+#endif
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,168 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* The dentry cache remembers the outcome of recent name lookups,
+ * keyed by the inode sector of the directory searched and the
+ * name searched for.  A positive entry holds the inode sector the
+ * name resolved to; a negative entry records that the name was
+ * absent.  Entries are dropped whenever the directory changes. */
+
+/* Maximum number of cached names. */
+#define DCACHE_SIZE 64
+
+/* A cached lookup result. */
+struct dcache_entry {
+	struct hash_elem hash_elem;         /* Element in dcache_table. */
+	struct list_elem lru_elem;          /* Element in dcache_lru. */
+	disk_sector_t parent;               /* Directory inode sector. */
+	char name[NAME_MAX + 1];            /* Name looked up in PARENT. */
+	disk_sector_t sector;               /* Inode sector, if PRESENT. */
+	bool present;                       /* Positive or negative entry. */
+};
+
+static struct hash dcache_table;
+static struct list dcache_lru;          /* Most recently used first. */
+static struct lock dcache_lock;
+
+/* Returns a hash value for entry E. */
+static uint64_t
+dcache_hash (const struct hash_elem *e_, void *aux UNUSED) {
+	const struct dcache_entry *e = hash_entry (e_, struct dcache_entry,
+			hash_elem);
+	return hash_string (e->name) ^ hash_int (e->parent);
+}
+
+/* Returns true if entry A precedes entry B. */
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dcache_entry *a = hash_entry (a_, struct dcache_entry,
+			hash_elem);
+	const struct dcache_entry *b = hash_entry (b_, struct dcache_entry,
+			hash_elem);
+
+	if (a->parent != b->parent)
+		return a->parent < b->parent;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void) {
+	hash_init (&dcache_table, dcache_hash, dcache_less, NULL);
+	list_init (&dcache_lru);
+	lock_init (&dcache_lock);
+}
+
+/* Returns the entry for NAME in PARENT, or a null pointer if
+ * there is none.  The caller must hold dcache_lock. */
+static struct dcache_entry *
+find_entry (disk_sector_t parent, const char *name) {
+	struct dcache_entry key;
+	struct hash_elem *e;
+
+	if (strlen (name) > NAME_MAX)
+		return NULL;
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dcache_table, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Removes and frees entry E.  The caller must hold dcache_lock. */
+static void
+drop_entry (struct dcache_entry *e) {
+	hash_delete (&dcache_table, &e->hash_elem);
+	list_remove (&e->lru_elem);
+	free (e);
+}
+
+/* Looks up NAME in directory PARENT without touching the disk.
+ * On DCACHE_POSITIVE, stores the file's inode sector in *SECTORP. */
+enum dcache_result
+dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp) {
+	struct dcache_entry *e;
+	enum dcache_result result = DCACHE_MISS;
+
+	lock_acquire (&dcache_lock);
+	e = find_entry (parent, name);
+	if (e != NULL) {
+		list_remove (&e->lru_elem);
+		list_push_front (&dcache_lru, &e->lru_elem);
+		if (e->present) {
+			*sectorp = e->sector;
+			result = DCACHE_POSITIVE;
+		} else
+			result = DCACHE_NEGATIVE;
+	}
+	lock_release (&dcache_lock);
+	return result;
+}
+
+/* Records that NAME in directory PARENT resolves to SECTOR if
+ * PRESENT is true, or does not exist if PRESENT is false.
+ * Evicts the least recently used entry if the cache is full. */
+void
+dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector, bool present) {
+	struct dcache_entry *e;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	e = find_entry (parent, name);
+	if (e == NULL) {
+		if (hash_size (&dcache_table) >= DCACHE_SIZE)
+			drop_entry (list_entry (list_back (&dcache_lru),
+						struct dcache_entry, lru_elem));
+		e = malloc (sizeof *e);
+		if (e == NULL) {
+			lock_release (&dcache_lock);
+			return;
+		}
+		e->parent = parent;
+		strlcpy (e->name, name, sizeof e->name);
+		hash_insert (&dcache_table, &e->hash_elem);
+	} else
+		list_remove (&e->lru_elem);
+	list_push_front (&dcache_lru, &e->lru_elem);
+	e->sector = sector;
+	e->present = present;
+	lock_release (&dcache_lock);
+}
+
+/* Forgets whatever is cached about NAME in directory PARENT. */
+void
+dcache_invalidate (disk_sector_t parent, const char *name) {
+	struct dcache_entry *e;
+
+	lock_acquire (&dcache_lock);
+	e = find_entry (parent, name);
+	if (e != NULL)
+		drop_entry (e);
+	lock_release (&dcache_lock);
+}
+
+/* Forgets every name cached for directory PARENT, e.g. because
+ * the directory's inode is going away. */
+void
+dcache_purge (disk_sector_t parent) {
+	struct list_elem *le;
+
+	lock_acquire (&dcache_lock);
+	for (le = list_begin (&dcache_lru); le != list_end (&dcache_lru);) {
+		struct dcache_entry *e = list_entry (le, struct dcache_entry, lru_elem);
+		le = list_next (le);
+		if (e->parent == parent)
+			drop_entry (e);
+	}
+	lock_release (&dcache_lock);
+}
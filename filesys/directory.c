@@ -2,6 +2,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <hash.h>
+#include <round.h>
+#include <dirent.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -17,13 +21,237 @@ struct dir_entry {
 	disk_sector_t inode_sector;         /* Sector number of header. */
 	char name[NAME_MAX + 1];            /* Null terminated file name. */
 	bool in_use;                        /* In use or free? */
+	bool is_dir;                        /* Names a directory? */
 };
 
+/* Directories are hashed.  The directory file is an array of
+ * buckets, one disk sector each.  A name lives in the bucket
+ * selected by its hash, or, if that bucket was full when the name
+ * was added, in one of the buckets that follow it (linear
+ * probing).  Each bucket records whether any entry that hashes to
+ * it spilled over, so a lookup normally reads a single sector.
+ *
+ * Rather than spill into a table that is more than DIR_MAX_LOAD
+ * percent full, dir_add() doubles the number of buckets and
+ * rehashes every entry, so a directory grows as it needs to and
+ * probe sequences stay short.  Bucket 0 keeps the number of entries
+ * in use, so that check costs one small read rather than a scan
+ * of the whole directory.  dir_remove() clears the overflow
+ * flags that no longer lead to any entry.  A rehash moves entries
+ * between slots, so a listing that runs across a dir_add() may
+ * see a name twice or miss one. */
+#define DIR_BUCKET_ENTRIES \
+	((DISK_SECTOR_SIZE - 2 * sizeof (uint32_t)) / sizeof (struct dir_entry))
+#define DIR_MAX_LOAD 75
+
+/* On-disk directory bucket.
+ * Must be no more than DISK_SECTOR_SIZE bytes long. */
+struct dir_bucket {
+	uint32_t overflow;                  /* Nonzero if probing must go on. */
+	struct dir_entry entries[DIR_BUCKET_ENTRIES];
+	uint32_t used;                      /* Bucket 0 only: entries in use
+	                                       in the whole directory. */
+};
+
+/* Returns the number of buckets in DIR. */
+static size_t
+bucket_cnt (const struct dir *dir) {
+	return inode_length (dir->inode) / DISK_SECTOR_SIZE;
+}
+
+/* Returns the byte offset of entry SLOT of bucket BUCKET. */
+static off_t
+entry_ofs (size_t bucket, size_t slot) {
+	return bucket * DISK_SECTOR_SIZE + offsetof (struct dir_bucket, entries)
+		+ slot * sizeof (struct dir_entry);
+}
+
+/* Reads bucket BUCKET of DIR into *B.
+ * Returns true if successful, false on a short read. */
+static bool
+read_bucket (const struct dir *dir, size_t bucket, struct dir_bucket *b) {
+	return inode_read_at (dir->inode, b, sizeof *b,
+			bucket * DISK_SECTOR_SIZE) == sizeof *b;
+}
+
+/* Returns bucket BUCKET of the in-memory bucket array TABLE,
+ * which is laid out as on disk, one sector per bucket. */
+static struct dir_bucket *
+bucket_at (uint8_t *table, size_t bucket) {
+	return (struct dir_bucket *) (table + bucket * DISK_SECTOR_SIZE);
+}
+
+/* Returns the number of entries in use in DIR, as kept in bucket
+ * 0. */
+static uint32_t
+used_cnt (const struct dir *dir) {
+	uint32_t used = 0;
+	inode_read_at (dir->inode, &used, sizeof used,
+			offsetof (struct dir_bucket, used));
+	return used;
+}
+
+/* Adds DELTA to the number of entries in use in DIR.  The caller
+ * holds DIR's lock. */
+static void
+adjust_used_cnt (struct dir *dir, int delta) {
+	uint32_t used = used_cnt (dir) + delta;
+	inode_write_at (dir->inode, &used, sizeof used,
+			offsetof (struct dir_bucket, used));
+}
+
+/* Returns true if more than DIR_MAX_LOAD percent of the slots in
+ * DIR are in use. */
+static bool
+crowded (const struct dir *dir) {
+	return (size_t) used_cnt (dir) * 100
+		> bucket_cnt (dir) * DIR_BUCKET_ENTRIES * DIR_MAX_LOAD;
+}
+
+/* Stores E in the first free slot on its probe sequence in the
+ * CNT-bucket array TABLE, flagging each full bucket it passes.
+ * TABLE must have a free slot. */
+static void
+place (uint8_t *table, size_t cnt, const struct dir_entry *e) {
+	size_t bucket = hash_string (e->name) % cnt;
+	size_t slot;
+
+	for (;; bucket = (bucket + 1) % cnt) {
+		struct dir_bucket *b = bucket_at (table, bucket);
+		for (slot = 0; slot < DIR_BUCKET_ENTRIES; slot++)
+			if (!b->entries[slot].in_use) {
+				b->entries[slot] = *e;
+				return;
+			}
+		b->overflow = 1;
+	}
+}
+
+/* Doubles the number of buckets in DIR and rehashes every entry
+ * into the new table, which carries only the overflow flags that
+ * the new placement needs.  The caller holds DIR's lock.
+ * Returns true if successful, false if memory or disk space runs
+ * out, in which case DIR is left as it was. */
+static bool
+grow (struct dir *dir) {
+	size_t old_cnt = bucket_cnt (dir);
+	size_t new_cnt = old_cnt * 2;
+	off_t old_size = old_cnt * DISK_SECTOR_SIZE;
+	off_t new_size = new_cnt * DISK_SECTOR_SIZE;
+	uint8_t *old_table, *new_table;
+	off_t written;
+	size_t i, slot;
+	uint32_t used = 0;
+	bool success = false;
+
+	old_table = malloc (old_size);
+	new_table = calloc (new_cnt, DISK_SECTOR_SIZE);
+	if (old_table == NULL || new_table == NULL
+			|| inode_read_at (dir->inode, old_table, old_size, 0) != old_size)
+		goto done;
+
+	for (i = 0; i < old_cnt; i++)
+		for (slot = 0; slot < DIR_BUCKET_ENTRIES; slot++) {
+			struct dir_entry *e = &bucket_at (old_table, i)->entries[slot];
+			if (e->in_use) {
+				place (new_table, new_cnt, e);
+				used++;
+			}
+		}
+	bucket_at (new_table, 0)->used = used;
+
+	if (!inode_set_length (dir->inode, new_size))
+		goto done;
+	written = inode_write_at (dir->inode, new_table, new_size, 0);
+	success = written == new_size;
+	if (!success) {
+		/* The disk filled up: put back what was overwritten. */
+		inode_write_at (dir->inode, old_table,
+				written < old_size ? written : old_size, 0);
+		inode_set_length (dir->inode, old_size);
+	}
+
+done:
+	free (old_table);
+	free (new_table);
+	return success;
+}
+
+/* Clears the overflow flags that no longer lead to any entry,
+ * after an entry was removed from bucket BUCKET of DIR.  Only the
+ * run of flagged buckets that reaches BUCKET can change: every
+ * entry whose probe sequence crosses the run was placed inside it
+ * or in the unflagged bucket that ends it.  The caller holds DIR's
+ * lock. */
+static void
+clear_overflow (struct dir *dir, size_t bucket) {
+	size_t cnt = bucket_cnt (dir);
+	size_t start = bucket, len = 1;
+	struct dir_bucket *b;
+	uint8_t *needed = NULL;
+	size_t i, slot;
+
+	b = malloc (sizeof *b);
+	if (b == NULL)
+		return;
+
+	/* Find the run: back to its first flagged bucket, forward to
+	 * the unflagged bucket that ends it.  A table flagged all the
+	 * way around is left alone. */
+	while (len < cnt && read_bucket (dir, (start + cnt - 1) % cnt, b)
+			&& b->overflow) {
+		start = (start + cnt - 1) % cnt;
+		len++;
+	}
+	while (len < cnt && read_bucket (dir, (start + len - 1) % cnt, b)
+			&& b->overflow)
+		len++;
+	if (len == 1 || len >= cnt)
+		goto done;
+
+	/* Work out which buckets in the run some entry still probes
+	 * past. */
+	needed = calloc (len, 1);
+	if (needed == NULL)
+		goto done;
+	for (i = 1; i < len; i++) {
+		if (!read_bucket (dir, (start + i) % cnt, b))
+			goto done;
+		for (slot = 0; slot < DIR_BUCKET_ENTRIES; slot++) {
+			struct dir_entry *e = &b->entries[slot];
+			size_t home;
+
+			if (!e->in_use)
+				continue;
+			home = (hash_string (e->name) % cnt + cnt - start) % cnt;
+			for (; home < i; home++)
+				needed[home] = 1;
+		}
+	}
+
+	for (i = 0; i + 1 < len; i++) {
+		uint32_t overflow = 0;
+		if (!needed[i])
+			inode_write_at (dir->inode, &overflow, sizeof overflow,
+					(start + i) % cnt * DISK_SECTOR_SIZE);
+	}
+
+done:
+	free (needed);
+	free (b);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+	size_t buckets = DIV_ROUND_UP (entry_cnt, DIR_BUCKET_ENTRIES);
+
+	ASSERT (sizeof (struct dir_bucket) <= DISK_SECTOR_SIZE);
+
+	if (buckets == 0)
+		buckets = 1;
+	return inode_create (sector, buckets * DISK_SECTOR_SIZE, true);
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -75,26 +303,61 @@ dir_get_inode (struct dir *dir) {
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
+ * otherwise, returns false and ignores EP and OFSP.
+ *
+ * Only the buckets on NAME's probe sequence are read.  If FREEP
+ * is non-null, it receives the offset of the first free slot on
+ * that sequence, or -1 if there is none, so that dir_add() does
+ * not need a second pass to find room for NAME. */
 static bool
 lookup (const struct dir *dir, const char *name,
-		struct dir_entry *ep, off_t *ofsp) {
-	struct dir_entry e;
-	size_t ofs;
+		struct dir_entry *ep, off_t *ofsp, off_t *freep) {
+	struct dir_bucket *b;
+	size_t cnt, home, i, slot;
+	bool found = false;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
-			if (ep != NULL)
-				*ep = e;
-			if (ofsp != NULL)
-				*ofsp = ofs;
-			return true;
+	if (freep != NULL)
+		*freep = -1;
+
+	cnt = bucket_cnt (dir);
+	if (cnt == 0)
+		return false;
+
+	b = malloc (sizeof *b);
+	if (b == NULL)
+		return false;
+
+	home = hash_string (name) % cnt;
+	for (i = 0; i < cnt && !found; i++) {
+		size_t bucket = (home + i) % cnt;
+
+		if (!read_bucket (dir, bucket, b))
+			break;
+		for (slot = 0; slot < DIR_BUCKET_ENTRIES; slot++) {
+			struct dir_entry *e = &b->entries[slot];
+			if (!e->in_use) {
+				if (freep != NULL && *freep == -1)
+					*freep = entry_ofs (bucket, slot);
+			} else if (!strcmp (name, e->name)) {
+				if (ep != NULL)
+					*ep = *e;
+				if (ofsp != NULL)
+					*ofsp = entry_ofs (bucket, slot);
+				found = true;
+				break;
+			}
 		}
-	return false;
+		/* Entries homed before this bucket never spill past a
+		 * bucket whose overflow flag is clear, but dir_add() may
+		 * still need to keep walking to find a free slot. */
+		if (!b->overflow && (freep == NULL || *freep != -1))
+			break;
+	}
+	free (b);
+	return found;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -105,28 +368,48 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
 	struct dir_entry e;
+	disk_sector_t parent, sector;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
-	else
-		*inode = NULL;
+	parent = inode_get_inumber (dir->inode);
+	inode_lock_dir (dir->inode);
+	switch (dcache_lookup (parent, name, &sector)) {
+		case DCACHE_POSITIVE:
+			*inode = inode_open (sector);
+			break;
+		case DCACHE_NEGATIVE:
+			*inode = NULL;
+			break;
+		case DCACHE_MISS:
+			if (lookup (dir, name, &e, NULL, NULL)) {
+				dcache_insert (parent, name, e.inode_sector, true);
+				*inode = inode_open (e.inode_sector);
+			} else {
+				dcache_insert (parent, name, 0, false);
+				*inode = NULL;
+			}
+			break;
+	}
+	inode_unlock_dir (dir->inode);
 
 	return *inode != NULL;
 }
 
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
- * INODE_SECTOR.
+ * INODE_SECTOR, and is a directory if IS_DIR is true.
  * Returns true if successful, false on failure.
  * Fails if NAME is invalid (i.e. too long) or a disk or memory
  * error occurs. */
 bool
-dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector,
+		bool is_dir) {
 	struct dir_entry e;
 	off_t ofs;
+	size_t cnt, bucket, target;
+	uint32_t overflow = 1;
 	bool success = false;
 
 	ASSERT (dir != NULL);
@@ -136,29 +419,46 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
-	/* Check that NAME is not in use. */
-	if (lookup (dir, name, NULL, NULL))
+	inode_lock_dir (dir->inode);
+
+	/* Check that NAME is not in use, and find a free slot on its
+	 * probe sequence while we are at it. */
+	if (lookup (dir, name, NULL, NULL, &ofs))
 		goto done;
 
-	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
+	/* Grow instead of spilling into a crowded table.  If growing
+	 * fails, a slot found before is still good. */
+	cnt = bucket_cnt (dir);
+	if (ofs == -1 || ((size_t) ofs / DISK_SECTOR_SIZE
+				!= hash_string (name) % cnt && crowded (dir))) {
+		if (grow (dir))
+			lookup (dir, name, NULL, NULL, &ofs);
+		cnt = bucket_cnt (dir);
+	}
+	if (ofs == -1)
+		goto done;
 
-	 * inode_read_at() will only return a short read at end of file.
-	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
+	/* If the home bucket was full, every bucket from it up to the
+	 * chosen one must now tell lookups to keep probing. */
+	target = ofs / DISK_SECTOR_SIZE;
+	for (bucket = hash_string (name) % cnt; bucket != target;
+			bucket = (bucket + 1) % cnt)
+		if (inode_write_at (dir->inode, &overflow, sizeof overflow,
+					bucket * DISK_SECTOR_SIZE) != sizeof overflow)
+			goto done;
 
 	/* Write slot. */
 	e.in_use = true;
+	e.is_dir = is_dir;
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (success)
+		adjust_used_cnt (dir, 1);
+	dcache_invalidate (inode_get_inumber (dir->inode), name);
 
 done:
+	inode_unlock_dir (dir->inode);
 	return success;
 }
 
@@ -175,8 +475,10 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	inode_lock_dir (dir->inode);
+
 	/* Find directory entry. */
-	if (!lookup (dir, name, &e, &ofs))
+	if (!lookup (dir, name, &e, &ofs, NULL))
 		goto done;
 
 	/* Open inode. */
@@ -184,33 +486,89 @@ dir_remove (struct dir *dir, const char *name) {
 	if (inode == NULL)
 		goto done;
 
-	/* Erase directory entry. */
+	/* Erase directory entry.  Cached lookups of NAME, and of
+	 * anything inside NAME should it be a directory, go stale. */
 	e.in_use = false;
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
+	adjust_used_cnt (dir, -1);
+	dcache_invalidate (inode_get_inumber (dir->inode), name);
+	dcache_purge (e.inode_sector);
+	clear_overflow (dir, ofs / DISK_SECTOR_SIZE);
 
 	/* Remove inode. */
 	inode_remove (inode);
 	success = true;
 
 done:
+	inode_unlock_dir (dir->inode);
 	inode_close (inode);
 	return success;
 }
 
+/* Reads up to MAX of the entries in DIR that follow its position
+ * into ENTS, with their inode numbers and types, and advances the
+ * position past them.  The directory is read a bucket at a time,
+ * under one hold of its lock.
+ * Returns the number of entries stored, 0 at the end of DIR.
+ * DIR's position counts entry slots, skipping bucket headers. */
+int
+dir_read_entries (struct dir *dir, struct dirent *ents, int max) {
+	size_t limit = bucket_cnt (dir) * DIR_BUCKET_ENTRIES;
+	size_t cached = SIZE_MAX;
+	struct dir_bucket *b;
+	int cnt = 0;
+
+	b = malloc (sizeof *b);
+	if (b == NULL)
+		return 0;
+
+	inode_lock_dir (dir->inode);
+	while (cnt < max && (size_t) dir->pos < limit) {
+		size_t bucket = dir->pos / DIR_BUCKET_ENTRIES;
+		struct dir_entry *e;
+
+		if (bucket != cached) {
+			if (!read_bucket (dir, bucket, b))
+				break;
+			cached = bucket;
+		}
+		e = &b->entries[dir->pos % DIR_BUCKET_ENTRIES];
+		dir->pos++;
+		if (e->in_use) {
+			ents[cnt].d_ino = e->inode_sector;
+			ents[cnt].d_type = e->is_dir ? DT_DIR : DT_REG;
+			strlcpy (ents[cnt].d_name, e->name, sizeof ents[cnt].d_name);
+			cnt++;
+		}
+	}
+	inode_unlock_dir (dir->inode);
+	free (b);
+	return cnt;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
  * NAME.  Returns true if successful, false if the directory
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
-	struct dir_entry e;
+	struct dirent ent;
 
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
-		dir->pos += sizeof e;
-		if (e.in_use) {
-			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
-		}
-	}
-	return false;
+	if (dir_read_entries (dir, &ent, 1) != 1)
+		return false;
+	strlcpy (name, ent.d_name, NAME_MAX + 1);
+	return true;
+}
+
+/* Sets DIR's position, as returned by dir_tell(). */
+void
+dir_seek (struct dir *dir, off_t pos) {
+	ASSERT (pos >= 0);
+	dir->pos = pos;
+}
+
+/* Returns DIR's position, in entry slots. */
+off_t
+dir_tell (const struct dir *dir) {
+	return dir->pos;
 }
@@ -16,10 +16,28 @@ struct fat_boot {
 	unsigned int root_dir_cluster;
 };
 
+/* Number of FAT entries held by one FAT sector. */
+#define FAT_ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* Number of FAT sectors kept in memory at once. */
+#define FAT_CACHE_SIZE 16
+
+/* A cached FAT sector.
+ * FAT sectors are paged in on demand by fat_get() and fat_put(),
+ * so mounting never reads the whole table. */
+struct fat_cache_entry {
+	bool valid;                         /* Holds a FAT sector? */
+	bool dirty;                         /* Modified since read in? */
+	bool accessed;                      /* Referenced since last sweep? */
+	unsigned int idx;                   /* Index of sector within FAT. */
+	cluster_t entries[FAT_ENTRIES_PER_SECTOR];
+};
+
 /* FAT FS */
 struct fat_fs {
 	struct fat_boot bs;
-	unsigned int *fat;
+	struct fat_cache_entry cache[FAT_CACHE_SIZE];
+	unsigned int clock_hand;            /* Next cache slot to consider. */
 	unsigned int fat_length;
 	disk_sector_t data_start;
 	cluster_t last_clst;
@@ -31,6 +49,10 @@ static struct fat_fs *fat_fs;
 void fat_boot_create (void);
 void fat_fs_init (void);
 
+static struct fat_cache_entry *fat_cache_lookup (unsigned int idx);
+static void fat_cache_flush (struct fat_cache_entry *);
+static void fat_cache_flush_all (void);
+
 void
 fat_init (void) {
 	fat_fs = calloc (1, sizeof (struct fat_fs));
@@ -51,35 +73,19 @@ fat_init (void) {
 	fat_fs_init ();
 }
 
+/* Mounts the FAT.  No FAT sector is read here; each one is paged
+ * in by the first fat_get() or fat_put() that touches it, so the
+ * cost of mounting does not depend on the size of the disk. */
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
-
-	// Load FAT directly from the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
-	}
+	unsigned int i;
+
+	for (i = 0; i < FAT_CACHE_SIZE; i++)
+		fat_fs->cache[i].valid = false;
+	fat_fs->clock_hand = 0;
 }
 
+/* Writes back the boot sector and every dirty FAT sector. */
 void
 fat_close (void) {
 	// Write FAT boot sector
@@ -90,27 +96,16 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	// Write back only the FAT sectors that were modified
+	fat_sync ();
+}
+
+/* Writes every dirty cached FAT sector back to the disk. */
+void
+fat_sync (void) {
+	lock_acquire (&fat_fs->write_lock);
+	fat_cache_flush_all ();
+	lock_release (&fat_fs->write_lock);
 }
 
 void
@@ -118,19 +113,20 @@ fat_create (void) {
 	// Create FAT boot
 	fat_boot_create ();
 	fat_fs_init ();
+	fat_open ();
 
-	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+	// Clear the on-disk FAT.  Formatting is the only operation that
+	// touches every FAT sector; everything else goes through the cache.
+	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
+	if (buf == NULL)
+		PANIC ("FAT create failed due to OOM");
+	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++)
+		disk_write (filesys_disk, fat_fs->bs.fat_start + i, buf);
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
-	if (buf == NULL)
-		PANIC ("FAT create failed due to OOM");
 	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
 	free (buf);
 }
@@ -152,7 +148,93 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->bs.fat_sectors - 1)
+	                     / SECTORS_PER_CLUSTER;
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	lock_init (&fat_fs->write_lock);
+}
+
+/*----------------------------------------------------------------------------*/
+/* FAT sector cache                                                           */
+/*----------------------------------------------------------------------------*/
+
+/* Writes cache entry E back to the disk if it is dirty. */
+static void
+fat_cache_flush (struct fat_cache_entry *e) {
+	if (e->valid && e->dirty) {
+		disk_write (filesys_disk, fat_fs->bs.fat_start + e->idx, e->entries);
+		e->dirty = false;
+	}
+}
+
+/* Writes back every dirty cache entry.
+ * The caller must hold the FAT lock. */
+static void
+fat_cache_flush_all (void) {
+	unsigned int i;
+
+	for (i = 0; i < FAT_CACHE_SIZE; i++)
+		fat_cache_flush (&fat_fs->cache[i]);
+}
+
+/* Returns the cache entry holding FAT sector IDX, reading it in
+ * (and evicting another sector with the clock algorithm) if
+ * needed.  The caller must hold the FAT lock. */
+static struct fat_cache_entry *
+fat_cache_lookup (unsigned int idx) {
+	struct fat_cache_entry *e;
+	unsigned int i;
+
+	ASSERT (idx < fat_fs->bs.fat_sectors);
+	ASSERT (lock_held_by_current_thread (&fat_fs->write_lock));
+
+	for (i = 0; i < FAT_CACHE_SIZE; i++) {
+		e = &fat_fs->cache[i];
+		if (e->valid && e->idx == idx) {
+			e->accessed = true;
+			return e;
+		}
+	}
+
+	/* Miss.  Pick a victim: an empty slot, or the first slot the
+	 * clock hand finds that has not been referenced recently. */
+	for (;;) {
+		e = &fat_fs->cache[fat_fs->clock_hand];
+		fat_fs->clock_hand = (fat_fs->clock_hand + 1) % FAT_CACHE_SIZE;
+		if (!e->valid || !e->accessed)
+			break;
+		e->accessed = false;
+	}
+
+	fat_cache_flush (e);
+	disk_read (filesys_disk, fat_fs->bs.fat_start + idx, e->entries);
+	e->valid = true;
+	e->dirty = false;
+	e->accessed = true;
+	e->idx = idx;
+	return e;
+}
+
+/* Fetches FAT entry CLST.  The caller must hold the FAT lock. */
+static cluster_t
+fat_get_locked (cluster_t clst) {
+	struct fat_cache_entry *e;
+
+	ASSERT (clst < fat_fs->fat_length);
+	e = fat_cache_lookup (clst / FAT_ENTRIES_PER_SECTOR);
+	return e->entries[clst % FAT_ENTRIES_PER_SECTOR];
+}
+
+/* Updates FAT entry CLST.  The caller must hold the FAT lock. */
+static void
+fat_put_locked (cluster_t clst, cluster_t val) {
+	struct fat_cache_entry *e;
+
+	ASSERT (clst < fat_fs->fat_length);
+	e = fat_cache_lookup (clst / FAT_ENTRIES_PER_SECTOR);
+	e->entries[clst % FAT_ENTRIES_PER_SECTOR] = val;
+	e->dirty = true;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -164,30 +246,74 @@ fat_fs_init (void) {
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t new_clst = 0;
+	cluster_t c;
+	unsigned int i;
+
+	lock_acquire (&fat_fs->write_lock);
+
+	/* Next-fit search starting after the last cluster handed out,
+	 * so that consecutive allocations touch neighbouring FAT
+	 * sectors instead of rescanning the table from the front. */
+	c = fat_fs->last_clst;
+	for (i = 1; i < fat_fs->fat_length; i++) {
+		c = c + 1 < fat_fs->fat_length ? c + 1 : ROOT_DIR_CLUSTER + 1;
+		if (fat_get_locked (c) == 0) {
+			new_clst = c;
+			break;
+		}
+	}
+
+	if (new_clst != 0) {
+		fat_put_locked (new_clst, EOChain);
+		if (clst != 0)
+			fat_put_locked (clst, new_clst);
+		fat_fs->last_clst = new_clst;
+	}
+
+	lock_release (&fat_fs->write_lock);
+	return new_clst;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+
+	if (pclst != 0)
+		fat_put_locked (pclst, EOChain);
+
+	while (clst != 0 && clst != EOChain) {
+		cluster_t next = fat_get_locked (clst);
+		fat_put_locked (clst, 0);
+		clst = next;
+	}
+
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	fat_put_locked (clst, val);
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t val;
+
+	lock_acquire (&fat_fs->write_lock);
+	val = fat_get_locked (clst);
+	lock_release (&fat_fs->write_lock);
+	return val;
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	return fat_fs->data_start + clst * SECTORS_PER_CLUSTER;
 }
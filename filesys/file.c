@@ -1,13 +1,23 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <round.h>
+#include <string.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
-/* An open file. */
+/* An open file.  It is either open on an inode or, with a null
+ * INODE, on one end of a pipe. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	bool direct;                /* Opened for direct I/O? */
+	struct pipe *pipe;          /* Pipe, if INODE is null. */
+	bool pipe_writer;           /* Write end of PIPE, or read end? */
+	int ref_cnt;                /* Descriptors sharing this file. */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +30,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -28,10 +39,57 @@ file_open (struct inode *inode) {
 	}
 }
 
-/* Opens and returns a new file for the same inode as FILE.
+/* Returns a new file for the write end of PIPE if WRITER is true,
+ * otherwise for its read end, without opening that end.  Returns a
+ * null pointer if an allocation fails. */
+static struct file *
+pipe_file (struct pipe *pipe, bool writer) {
+	struct file *file = calloc (1, sizeof *file);
+	if (file != NULL) {
+		file->pipe = pipe;
+		file->pipe_writer = writer;
+		file->ref_cnt = 1;
+	}
+	return file;
+}
+
+/* Creates a pipe and opens a file on each end, storing the one to
+ * read from in *READERP and the one to write to in *WRITERP.
+ * Returns true if successful, false if an allocation fails. */
+bool
+file_open_pipe (struct file **readerp, struct file **writerp) {
+	struct pipe *pipe = pipe_create ();
+	if (pipe == NULL)
+		return false;
+	*readerp = pipe_file (pipe, false);
+	*writerp = pipe_file (pipe, true);
+	if (*readerp == NULL || *writerp == NULL) {
+		free (*readerp);
+		free (*writerp);
+		pipe_close (pipe, false);
+		pipe_close (pipe, true);
+		return false;
+	}
+	return true;
+}
+
+/* Returns true if FILE is open on a pipe. */
+bool
+file_is_pipe (struct file *file) {
+	return file->inode == NULL;
+}
+
+/* Opens and returns a new file for the same inode as FILE, or the
+ * same end of the same pipe.
  * Returns a null pointer if unsuccessful. */
 struct file *
 file_reopen (struct file *file) {
+	if (file_is_pipe (file)) {
+		struct file *nfile = pipe_file (file->pipe, file->pipe_writer);
+		if (nfile != NULL)
+			pipe_open (file->pipe, file->pipe_writer);
+		return nfile;
+	}
 	return file_open (inode_reopen (file->inode));
 }
 
@@ -39,39 +97,77 @@ file_reopen (struct file *file) {
  * same inode as FILE. Returns a null pointer if unsuccessful. */
 struct file *
 file_duplicate (struct file *file) {
-	struct file *nfile = file_open (inode_reopen (file->inode));
+	struct file *nfile;
+
+	if (file_is_pipe (file))
+		return file_reopen (file);
+	nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
+		nfile->direct = file->direct;
 		if (file->deny_write)
 			file_deny_write (nfile);
 	}
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Adds a reference to FILE for another descriptor and returns
+ * FILE.  Unlike file_duplicate(), both descriptors then share one
+ * file position, as dup2() requires.  Each reference is dropped
+ * with file_close(). */
+struct file *
+file_share (struct file *file) {
+	ASSERT (file->ref_cnt > 0);
+	file->ref_cnt++;
+	return file;
+}
+
+/* Drops a reference to FILE and closes it when it was the last. */
 void
 file_close (struct file *file) {
 	if (file != NULL) {
-		file_allow_write (file);
-		inode_close (file->inode);
+		ASSERT (file->ref_cnt > 0);
+		if (--file->ref_cnt > 0)
+			return;
+		if (file_is_pipe (file))
+			pipe_close (file->pipe, file->pipe_writer);
+		else {
+			file_allow_write (file);
+			inode_close (file->inode);
+		}
 		free (file);
 	}
 }
 
-/* Returns the inode encapsulated by FILE. */
+/* Returns the inode encapsulated by FILE, or a null pointer for
+ * a pipe. */
 struct inode *
 file_get_inode (struct file *file) {
 	return file->inode;
 }
 
+/* Returns true if FILE is a directory.  Only the directory code
+ * changes a directory's contents, through its inode, so the writes
+ * below return -1 for one. */
+static bool
+is_directory (struct file *file) {
+	return !file_is_pipe (file) && inode_is_dir (file->inode);
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
  * starting at the file's current position.
  * Returns the number of bytes actually read,
  * which may be less than SIZE if end of file is reached.
- * Advances FILE's position by the number of bytes read. */
+ * Advances FILE's position by the number of bytes read.
+ * A pipe's read end waits for data instead, and returns 0 only at
+ * end of file; its write end cannot be read and returns -1. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read;
+
+	if (file_is_pipe (file))
+		return file->pipe_writer ? -1 : pipe_read (file->pipe, buffer, size);
+	bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
 	return bytes_read;
 }
@@ -92,10 +188,18 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
  * which may be less than SIZE if end of file is reached.
  * (Normally we'd grow the file in that case, but file growth is
  * not yet implemented.)
- * Advances FILE's position by the number of bytes read. */
+ * Advances FILE's position by the number of bytes read.
+ * A pipe's write end waits for room instead; its read end cannot
+ * be written and returns -1, as does a directory. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) {
-	off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+	off_t bytes_written;
+
+	if (file_is_pipe (file))
+		return file->pipe_writer ? pipe_write (file->pipe, buffer, size) : -1;
+	if (is_directory (file))
+		return -1;
+	bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_written;
 	return bytes_written;
 }
@@ -106,13 +210,189 @@ file_write (struct file *file, const void *buffer, off_t size) {
  * which may be less than SIZE if end of file is reached.
  * (Normally we'd grow the file in that case, but file growth is
  * not yet implemented.)
- * The file's current position is unaffected. */
+ * The file's current position is unaffected.
+ * Returns -1 if FILE is a directory. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
 		off_t file_ofs) {
+	if (is_directory (file))
+		return -1;
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads SIZE bytes from FILE, starting at the file's current
+ * position, which must be sector-aligned, directly into the pages
+ * at kernel addresses PAGES, PGSIZE bytes per page.
+ * Returns the number of bytes actually read.
+ * Advances FILE's position by the number of bytes read. */
+off_t
+file_read_pages (struct file *file, void **pages, off_t size) {
+	off_t bytes_read = inode_read_pages (file->inode, pages, size, file->pos);
+	file->pos += bytes_read;
+	return bytes_read;
+}
+
+/* Writes SIZE bytes to FILE, starting at the file's current
+ * position, which must be sector-aligned, directly from the pages
+ * at kernel addresses PAGES, PGSIZE bytes per page.
+ * Returns the number of bytes actually written, or -1 if FILE is a
+ * directory.
+ * Advances FILE's position by the number of bytes written. */
+off_t
+file_write_pages (struct file *file, void **pages, off_t size) {
+	off_t bytes_written;
+
+	if (is_directory (file))
+		return -1;
+	bytes_written = inode_write_pages (file->inode, pages, size,
+			file->pos);
+	file->pos += bytes_written;
+	return bytes_written;
+}
+
+/* Sets whether FILE was opened for direct I/O, in which suitably
+ * aligned reads and writes skip all intermediate copies. */
+void
+file_set_direct (struct file *file, bool direct) {
+	ASSERT (file != NULL);
+	file->direct = direct;
+}
+
+/* Returns true if FILE was opened for direct I/O. */
+bool
+file_is_direct (struct file *file) {
+	ASSERT (file != NULL);
+	return file->direct;
+}
+
+/* In-kernel copying. */
+
+/* Reads up to SIZE bytes, at most PGSIZE, from FILE into kernel
+ * page PAGE, by direct I/O if FILE's position is sector-aligned. */
+static off_t
+read_page (struct file *file, void *page, off_t size) {
+	if (file->pos % DISK_SECTOR_SIZE == 0)
+		return file_read_pages (file, &page, size);
+	return file_read (file, page, size);
+}
+
+/* Writes SIZE bytes, at most PGSIZE, from kernel page PAGE to
+ * FILE, by direct I/O if FILE's position is sector-aligned. */
+static off_t
+write_page (struct file *file, void *page, off_t size) {
+	if (file->pos % DISK_SECTOR_SIZE == 0)
+		return file_write_pages (file, &page, size);
+	return file_write (file, page, size);
+}
+
+/* Returns the size of the next chunk of a copy with LEFT bytes to
+ * go, reading from position POS: up to the next page boundary in
+ * the source, so that later chunks are page-aligned there. */
+static off_t
+next_chunk (off_t pos, off_t left) {
+	off_t chunk = PGSIZE - pos % PGSIZE;
+	return left < chunk ? left : chunk;
+}
+
+/* Copies up to SIZE bytes from SRC to DST, starting at each
+ * file's current position, through a single kernel page, and
+ * advances both positions.  Sector-aligned chunks move straight
+ * between the disk and that page in as few commands as each
+ * file's extents allow.
+ * Returns the number of bytes copied, which may be less than SIZE
+ * if the end of either file is reached, or -1 if DST is a
+ * directory. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size) {
+	void *page;
+	off_t copied = 0;
+
+	if (is_directory (dst))
+		return -1;
+	page = palloc_get_page (0);
+	if (page == NULL)
+		return 0;
+	while (copied < size) {
+		off_t chunk = next_chunk (src->pos, size - copied);
+		off_t n = read_page (src, page, chunk);
+		off_t w = n > 0 ? write_page (dst, page, n) : 0;
+
+		copied += w;
+		if (w < n) {
+			/* Leave SRC just past what actually got copied. */
+			src->pos -= n - w;
+			break;
+		}
+		if (n < chunk)
+			break;
+	}
+	palloc_free_page (page);
+	return copied;
+}
+
+/* Copies SIZE bytes from disk D, starting at sector SEC_NO, to
+ * FILE at its current position, a page of sectors per disk
+ * command, and advances FILE's position.
+ * Returns the number of bytes copied, which may be less than SIZE
+ * if the end of FILE is reached, or -1 if FILE is a directory. */
+off_t
+file_copy_from_disk (struct file *file, struct disk *d, disk_sector_t sec_no,
+		off_t size) {
+	void *page;
+	off_t copied = 0;
+
+	if (is_directory (file))
+		return -1;
+	page = palloc_get_page (0);
+	if (page == NULL)
+		return 0;
+	while (copied < size) {
+		off_t chunk = size - copied < PGSIZE ? size - copied : PGSIZE;
+		size_t sectors = DIV_ROUND_UP (chunk, DISK_SECTOR_SIZE);
+		off_t w;
+
+		disk_read_sectors (d, sec_no, page, sectors);
+		sec_no += sectors;
+		w = write_page (file, page, chunk);
+		copied += w;
+		if (w < chunk)
+			break;
+	}
+	palloc_free_page (page);
+	return copied;
+}
+
+/* Copies SIZE bytes from FILE, at its current position, to disk D
+ * starting at sector SEC_NO, a page of sectors per disk command,
+ * and advances FILE's position.  The last sector is padded with
+ * zeros.
+ * Returns the number of bytes copied, which may be less than SIZE
+ * if the end of FILE is reached. */
+off_t
+file_copy_to_disk (struct disk *d, disk_sector_t sec_no, struct file *file,
+		off_t size) {
+	void *page = palloc_get_page (0);
+	off_t copied = 0;
+
+	if (page == NULL)
+		return 0;
+	while (copied < size) {
+		off_t chunk = size - copied < PGSIZE ? size - copied : PGSIZE;
+		off_t n = read_page (file, page, chunk);
+		size_t sectors = DIV_ROUND_UP (n, DISK_SECTOR_SIZE);
+
+		memset ((uint8_t *) page + n, 0, sectors * DISK_SECTOR_SIZE - n);
+		if (sectors > 0)
+			disk_write_sectors (d, sec_no, page, sectors);
+		sec_no += sectors;
+		copied += n;
+		if (n < chunk)
+			break;
+	}
+	palloc_free_page (page);
+	return copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -136,10 +416,12 @@ file_allow_write (struct file *file) {
 	}
 }
 
-/* Returns the size of FILE in bytes. */
+/* Returns the size of FILE in bytes, which is 0 for a pipe. */
 off_t
 file_length (struct file *file) {
 	ASSERT (file != NULL);
+	if (file_is_pipe (file))
+		return 0;
 	return inode_length (file->inode);
 }
 
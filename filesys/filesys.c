@@ -6,6 +6,8 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/dcache.h"
+#include "filesys/tmpfs.h"
 #include "devices/disk.h"
 
 /* The disk that contains the file system. */
@@ -22,6 +24,8 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
+	dcache_init ();
+	tmpfs_init ();
 
 #ifdef EFILESYS
 	fat_init ();
@@ -56,15 +60,24 @@ filesys_done (void) {
 /* Creates a file named NAME with the given INITIAL_SIZE.
  * Returns true if successful, false otherwise.
  * Fails if a file named NAME already exists,
- * or if internal memory allocation fails. */
+ * or if internal memory allocation fails.
+ * Names under TMPFS_PREFIX go to the tmpfs. */
 bool
 filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
-	struct dir *dir = dir_open_root ();
-	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
-			&& inode_create (inode_sector, initial_size)
-			&& dir_add (dir, name, inode_sector));
+	struct dir *dir;
+	bool success;
+
+	if (tmpfs_name (name) != NULL)
+		return tmpfs_create (tmpfs_name (name), initial_size);
+
+	dir = dir_open_root ();
+	/* Place the inode near its directory; its data then follows. */
+	success = (dir != NULL
+			&& free_map_allocate_near (1,
+				inode_get_inumber (dir_get_inode (dir)), &inode_sector)
+			&& inode_create (inode_sector, initial_size, false)
+			&& dir_add (dir, name, inode_sector, false));
 	if (!success && inode_sector != 0)
 		free_map_release (inode_sector, 1);
 	dir_close (dir);
@@ -72,16 +85,24 @@ filesys_create (const char *name, off_t initial_size) {
 	return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file with the given NAME.  "/" names the root
+ * directory itself, so that it can be listed, and names under
+ * TMPFS_PREFIX are looked up in the tmpfs.
  * Returns the new file if successful or a null pointer
  * otherwise.
  * Fails if no file named NAME exists,
  * or if an internal memory allocation fails. */
 struct file *
 filesys_open (const char *name) {
-	struct dir *dir = dir_open_root ();
+	struct dir *dir;
 	struct inode *inode = NULL;
 
+	if (!strcmp (name, "/"))
+		return file_open (inode_open (ROOT_DIR_SECTOR));
+	if (tmpfs_name (name) != NULL)
+		return tmpfs_open (tmpfs_name (name));
+
+	dir = dir_open_root ();
 	if (dir != NULL)
 		dir_lookup (dir, name, &inode);
 	dir_close (dir);
@@ -95,8 +116,14 @@ filesys_open (const char *name) {
  * or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) {
-	struct dir *dir = dir_open_root ();
-	bool success = dir != NULL && dir_remove (dir, name);
+	struct dir *dir;
+	bool success;
+
+	if (tmpfs_name (name) != NULL)
+		return tmpfs_remove (tmpfs_name (name));
+
+	dir = dir_open_root ();
+	success = dir != NULL && dir_remove (dir, name);
 	dir_close (dir);
 
 	return success;
@@ -1,12 +1,20 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct lock free_map_lock;    /* Serializes allocation and release. */
+
+/* Sectors of the free map file whose in-memory contents have not
+   been written back yet, one bit per file sector.  Changes to the
+   free map only mark these; free_map_flush() writes them. */
+static struct bitmap *dirty_sectors;
 
 /* Initializes the free map. */
 void
@@ -16,6 +24,22 @@ free_map_init (void) {
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	dirty_sectors = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+				DISK_SECTOR_SIZE));
+	if (dirty_sectors == NULL)
+		PANIC ("bitmap creation failed--disk is too large");
+	lock_init (&free_map_lock);
+}
+
+/* Marks the free map file sectors that hold the bits for disk
+   sectors SECTOR...SECTOR + CNT - 1 as dirty. */
+static void
+mark_dirty (disk_sector_t sector, size_t cnt) {
+	size_t first = sector / 8 / DISK_SECTOR_SIZE;
+	size_t last = (sector + cnt - 1) / 8 / DISK_SECTOR_SIZE;
+
+	ASSERT (lock_held_by_current_thread (&free_map_lock));
+	bitmap_set_multiple (dirty_sectors, first, last - first + 1, true);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -24,13 +48,27 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
-	}
+	return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* Allocates CNT consecutive sectors from the free map, preferring
+ * the first run at or after sector GOAL, and stores the first into
+ * *SECTORP.  Wraps around to the start of the disk if nothing
+ * after GOAL fits.
+ * Returns true if successful, false otherwise. */
+bool
+free_map_allocate_near (size_t cnt, disk_sector_t goal,
+		disk_sector_t *sectorp) {
+	disk_sector_t sector = BITMAP_ERROR;
+
+	lock_acquire (&free_map_lock);
+	if (goal < bitmap_size (free_map))
+		sector = bitmap_scan_and_flip (free_map, goal, cnt, false);
+	if (sector == BITMAP_ERROR && goal != 0)
+		sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	if (sector != BITMAP_ERROR)
+		mark_dirty (sector, cnt);
+	lock_release (&free_map_lock);
 	if (sector != BITMAP_ERROR)
 		*sectorp = sector;
 	return sector != BITMAP_ERROR;
@@ -39,9 +77,27 @@ free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
-	bitmap_write (free_map, free_map_file);
+	mark_dirty (sector, cnt);
+	lock_release (&free_map_lock);
+}
+
+/* Writes the dirty sectors of the free map back to the free map
+   file. */
+void
+free_map_flush (void) {
+	size_t idx;
+
+	lock_acquire (&free_map_lock);
+	if (free_map_file != NULL)
+		while ((idx = bitmap_scan_and_flip (dirty_sectors, 0, 1, true))
+				!= BITMAP_ERROR)
+			if (!bitmap_write_range (free_map, free_map_file,
+						idx * DISK_SECTOR_SIZE, DISK_SECTOR_SIZE))
+				PANIC ("can't write free map");
+	lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -57,7 +113,13 @@ free_map_open (void) {
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
+	/* Sectors preallocated to open inodes, the free map file's own
+	 * among them, must be free in the copy we write, or they would
+	 * stay allocated for good. */
+	inode_release_all_prealloc ();
+	free_map_flush ();
 	file_close (free_map_file);
+	free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -65,7 +127,7 @@ free_map_close (void) {
 void
 free_map_create (void) {
 	/* Create inode. */
-	if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+	if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
 		PANIC ("free map creation failed");
 
 	/* Write bitmap to file. */
@@ -74,4 +136,8 @@ free_map_create (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_write (free_map, free_map_file))
 		PANIC ("can't write free map");
+
+	/* Writing the file allocated its sectors, which dirtied parts
+	 * of the map that had already been written. */
+	free_map_flush ();
 }
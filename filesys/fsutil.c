@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,7 +82,7 @@ fsutil_put (char **argv) {
 	const char *file_name = argv[1];
 	struct disk *src;
 	struct file *dst;
-	off_t size;
+	off_t size, copied;
 	void *buffer;
 
 	printf ("Putting '%s' into the file system...\n", file_name);
@@ -112,14 +113,11 @@ fsutil_put (char **argv) {
 		PANIC ("%s: open failed", file_name);
 
 	/* Do copy. */
-	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		disk_read (src, sector++, buffer);
-		if (file_write (dst, buffer, chunk_size) != chunk_size)
-			PANIC ("%s: write failed with %"PROTd" bytes unwritten",
-					file_name, size);
-		size -= chunk_size;
-	}
+	copied = file_copy_from_disk (dst, src, sector, size);
+	if (copied != size)
+		PANIC ("%s: write failed with %"PROTd" bytes unwritten",
+				file_name, size - copied);
+	sector += DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 
 	/* Finish up. */
 	file_close (dst);
@@ -145,7 +143,7 @@ fsutil_get (char **argv) {
 	void *buffer;
 	struct file *src;
 	struct disk *dst;
-	off_t size;
+	off_t size, copied;
 
 	printf ("Getting '%s' from the file system...\n", file_name);
 
@@ -172,16 +170,13 @@ fsutil_get (char **argv) {
 	disk_write (dst, sector++, buffer);
 
 	/* Do copy. */
-	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		if (sector >= disk_size (dst))
-			PANIC ("%s: out of space on scratch disk", file_name);
-		if (file_read (src, buffer, chunk_size) != chunk_size)
-			PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-		memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-		disk_write (dst, sector++, buffer);
-		size -= chunk_size;
-	}
+	if (sector + DIV_ROUND_UP (size, DISK_SECTOR_SIZE) > disk_size (dst))
+		PANIC ("%s: out of space on scratch disk", file_name);
+	copied = file_copy_to_disk (dst, sector, src, size);
+	if (copied != size)
+		PANIC ("%s: read failed with %"PROTd" bytes unread",
+				file_name, size - copied);
+	sector += DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 
 	/* Finish up. */
 	file_close (src);
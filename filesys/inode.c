@@ -1,22 +1,53 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Block map geometry.  Data sectors are found through DIRECT_CNT
+ * direct pointers, then one indirect and one doubly indirect
+ * index block of INDEX_CNT pointers each. */
+#define DIRECT_CNT 123
+#define INDEX_CNT (DISK_SECTOR_SIZE / sizeof (disk_sector_t))
+#define MAX_SECTORS (DIRECT_CNT + INDEX_CNT + INDEX_CNT * INDEX_CNT)
+
+/* A block pointer that names no sector.  Sector 0 always holds
+ * the free map, so it is never a file's data or index block.  A
+ * null pointer is a hole: it reads as zeros and gets a sector on
+ * first write. */
+#define NO_SECTOR 0
+
+/* Number of contiguous sectors reserved at a time for a file's
+ * future data sectors.  See allocate_sector(). */
+#define PREALLOC_CNT 16
+
+/* Inode numbers handed to RAM inodes start here, above any disk
+ * sector, so that they never collide with a disk inode's. */
+#define RAM_INUMBER_BASE 0x40000000
+
+/* Most data pages that all RAM inodes together may hold, so that
+ * the tmpfs cannot drain the kernel pool.  A write that needs
+ * more stops short, as a write to a full disk does. */
+#define RAM_MAX_PAGES 256
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	disk_sector_t direct[DIRECT_CNT];   /* Direct data sectors. */
+	disk_sector_t indirect;             /* Index of data sectors. */
+	disk_sector_t doubly_indirect;      /* Index of index sectors. */
+	uint32_t is_dir;                    /* Nonzero if a directory. */
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,44 +59,216 @@ bytes_to_sectors (off_t size) {
 
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in open_inodes. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rwlock;               /* Guards data and file contents. */
+	struct lock dir_lock;               /* Serializes directory updates. */
+	disk_sector_t last_sector;          /* Last sector allocated to us. */
+	disk_sector_t window_start;         /* Next preallocated sector. */
+	size_t window_cnt;                  /* Preallocated sectors left. */
+	void **pages;                       /* RAM inode's data pages, or null. */
+	unsigned generation;                /* Bumped on every write. */
 	struct inode_disk data;             /* Inode content. */
 };
 
+/* Allocates a sector for INODE and stores it in *SECTORP.
+ *
+ * Allocation is goal-directed: the new sector goes right after
+ * the last one given to INODE, so a file that grows by appending
+ * stays contiguous.  Data sectors (INDEX false) are carved out of
+ * a window of PREALLOC_CNT sectors reserved in one go, which keeps
+ * files being written at the same time from interleaving.  The
+ * unused part of the window goes back to the free map when the
+ * inode is closed.  Index blocks (INDEX true) are placed one at a
+ * time next to the data. */
+static bool
+allocate_sector (struct inode *inode, bool index, disk_sector_t *sectorp) {
+	disk_sector_t goal = inode->last_sector + 1;
+
+	if (index)
+		return free_map_allocate_near (1, goal, sectorp);
+
+	if (inode->window_cnt == 0) {
+		if (free_map_allocate_near (PREALLOC_CNT, goal, &inode->window_start))
+			inode->window_cnt = PREALLOC_CNT;
+		else if (free_map_allocate_near (1, goal, &inode->window_start))
+			inode->window_cnt = 1;
+		else
+			return false;
+	}
+	*sectorp = inode->last_sector = inode->window_start++;
+	inode->window_cnt--;
+	return true;
+}
+
+/* Returns the sector that *SLOT points to.  If *SLOT is a hole
+ * and ALLOCATE is true, first allocates a sector of INODE for it,
+ * an index block if INDEX is true, which is zeroed, or a data
+ * sector otherwise, and sets *CHANGED.  Returns NO_SECTOR for a
+ * hole that is left unfilled or could not be filled. */
+static disk_sector_t
+resolve (struct inode *inode, disk_sector_t *slot, bool allocate, bool index,
+		bool *changed) {
+	static char zeros[DISK_SECTOR_SIZE];
+
+	if (*slot == NO_SECTOR && allocate
+			&& allocate_sector (inode, index, slot)) {
+		if (index)
+			disk_write (filesys_disk, *slot, zeros);
+		*changed = true;
+	}
+	return *slot;
+}
+
+/* Returns entry IDX of index block BLOCK, resolving it as
+ * resolve() does and writing BLOCK back if the entry changed.
+ * Sets *CHANGED if so. */
+static disk_sector_t
+index_resolve (struct inode *inode, disk_sector_t block, size_t idx,
+		bool allocate, bool index, bool *changed) {
+	disk_sector_t *entries;
+	disk_sector_t sector;
+	bool entry_changed = false;
+
+	if (block == NO_SECTOR)
+		return NO_SECTOR;
+	entries = malloc (DISK_SECTOR_SIZE);
+	if (entries == NULL)
+		return NO_SECTOR;
+	disk_read (filesys_disk, block, entries);
+	sector = resolve (inode, &entries[idx], allocate, index, &entry_changed);
+	if (entry_changed) {
+		disk_write (filesys_disk, block, entries);
+		*changed = true;
+	}
+	free (entries);
+	return sector;
+}
+
 /* Returns the disk sector that contains byte offset POS within
- * INODE.
- * Returns -1 if INODE does not contain data for a byte at offset
- * POS. */
+ * INODE, or NO_SECTOR if that part of the file is a hole.  If ALLOCATE is
+ * true, holes are filled, along with any index blocks on the way,
+ * and *FRESH is set when the returned sector is newly allocated;
+ * its contents are then undefined.  NO_SECTOR is still returned if
+ * the disk is full. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos, bool allocate, bool *fresh) {
+	struct inode_disk *d = &inode->data;
+	size_t idx = pos / DISK_SECTOR_SIZE;
+	bool inode_changed = false;
+	bool data_changed = false;
+	disk_sector_t sector, block;
+
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
-		return -1;
+	ASSERT (idx < MAX_SECTORS);
+
+	/* Before reserving a new window, aim it just past the data that
+	 * precedes POS, if there is any. */
+	if (allocate && inode->window_cnt == 0 && idx > 0) {
+		disk_sector_t prev = byte_to_sector (inode, pos - DISK_SECTOR_SIZE,
+				false, NULL);
+		if (prev != NO_SECTOR)
+			inode->last_sector = prev;
+	}
+
+	if (idx < DIRECT_CNT) {
+		sector = resolve (inode, &d->direct[idx], allocate, false,
+				&inode_changed);
+		data_changed = inode_changed;
+	} else if ((idx -= DIRECT_CNT) < INDEX_CNT) {
+		block = resolve (inode, &d->indirect, allocate, true, &inode_changed);
+		sector = index_resolve (inode, block, idx, allocate, false,
+				&data_changed);
+	} else {
+		bool index_changed = false;
+		idx -= INDEX_CNT;
+		block = resolve (inode, &d->doubly_indirect, allocate, true,
+				&inode_changed);
+		block = index_resolve (inode, block, idx / INDEX_CNT, allocate, true,
+				&index_changed);
+		sector = index_resolve (inode, block, idx % INDEX_CNT, allocate, false,
+				&data_changed);
+	}
+
+	if (inode_changed)
+		disk_write (filesys_disk, inode->sector, d);
+	if (fresh != NULL)
+		*fresh = data_changed;
+	return sector;
+}
+
+/* Releases index or data sector SECTOR and, for an index block
+ * LEVEL levels above the data, everything it points to. */
+static void
+release_tree (disk_sector_t sector, int level) {
+	if (sector == NO_SECTOR)
+		return;
+	if (level > 0) {
+		disk_sector_t *entries = malloc (DISK_SECTOR_SIZE);
+		size_t i;
+
+		if (entries != NULL) {
+			disk_read (filesys_disk, sector, entries);
+			for (i = 0; i < INDEX_CNT; i++)
+				release_tree (entries[i], level - 1);
+			free (entries);
+		}
+	}
+	free_map_release (sector, 1);
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, indexed by sector, so that opening a single inode
+ * twice returns the same `struct inode'.  RAM inodes are not in
+ * here: they can only be reached through the pointer that
+ * inode_create_ram() returned. */
+static struct hash open_inodes;
+
+/* Protects open_inodes, every inode's open_cnt and
+ * next_ram_inumber. */
+static struct lock open_inodes_lock;
+
+/* Inode number for the next RAM inode. */
+static disk_sector_t next_ram_inumber = RAM_INUMBER_BASE;
+
+/* Number of data pages held by RAM inodes, at most RAM_MAX_PAGES,
+ * and the lock that protects it. */
+static size_t ram_page_cnt;
+static struct lock ram_pages_lock;
+
+/* Returns a hash value for inode E. */
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+/* Returns true if inode A precedes inode B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	lock_init (&open_inodes_lock);
+	lock_init (&ram_pages_lock);
 }
 
-/* Initializes an inode with LENGTH bytes of data and
- * writes the new inode to sector SECTOR on the file system
- * disk.
+/* Initializes an inode with LENGTH bytes of data, a directory if
+ * IS_DIR is true, and writes the new inode to sector SECTOR on the
+ * file system disk.  The data starts out as one hole: no sectors
+ * are allocated until they are first written.
  * Returns true if successful.
- * Returns false if memory or disk allocation fails. */
+ * Returns false if memory allocation fails or LENGTH is too
+ * large. */
 bool
-inode_create (disk_sector_t sector, off_t length) {
+inode_create (disk_sector_t sector, off_t length, bool is_dir) {
 	struct inode_disk *disk_inode = NULL;
 	bool success = false;
 
@@ -75,22 +278,16 @@ inode_create (disk_sector_t sector, off_t length) {
 	 * one sector in size, and you should fix that. */
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
 
+	if (bytes_to_sectors (length) > MAX_SECTORS)
+		return false;
+
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
+		disk_inode->is_dir = is_dir;
+		disk_write (filesys_disk, sector, disk_inode);
+		success = true;
 		free (disk_inode);
 	}
 	return success;
@@ -101,39 +298,117 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
+	struct inode key;
+	struct hash_elem *e;
 	struct inode *inode;
 
+	lock_acquire (&open_inodes_lock);
+
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.sector = sector;
+	e = hash_find (&open_inodes, &key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+		return inode;
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  The lock is held across the read so that a
+	 * concurrent opener of the same sector finds this inode
+	 * instead of creating a second one. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	rwlock_init (&inode->rwlock);
+	lock_init (&inode->dir_lock);
+	inode->last_sector = sector;
+	inode->window_cnt = 0;
+	inode->generation = 0;
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	hash_insert (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+	return inode;
+}
+
+/* Returns a zeroed page for a RAM inode's data, or a null pointer
+ * if RAM inodes already hold RAM_MAX_PAGES pages or the kernel
+ * pool is empty. */
+static void *
+ram_page_alloc (void) {
+	void *page = NULL;
+
+	lock_acquire (&ram_pages_lock);
+	if (ram_page_cnt < RAM_MAX_PAGES
+			&& (page = palloc_get_page (PAL_ZERO)) != NULL)
+		ram_page_cnt++;
+	lock_release (&ram_pages_lock);
+	return page;
+}
+
+/* Frees PAGE, a RAM inode's data page from ram_page_alloc(), if
+ * it is not a null pointer. */
+static void
+ram_page_free (void *page) {
+	if (page == NULL)
+		return;
+	palloc_free_page (page);
+	lock_acquire (&ram_pages_lock);
+	ram_page_cnt--;
+	lock_release (&ram_pages_lock);
+}
+
+/* Creates an inode with LENGTH bytes of data that lives only in
+ * memory, and returns it open once.  Its data is an array of
+ * pages from the kernel pool, each allocated and zeroed on first
+ * write, up to RAM_MAX_PAGES for all RAM inodes together; until
+ * then a page reads as zeros, like a hole on disk.
+ * Everything is freed when the inode is last closed.
+ * Returns a null pointer if memory allocation fails. */
+struct inode *
+inode_create_ram (off_t length) {
+	struct inode *inode;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+	ASSERT (length >= 0);
+
+	inode = calloc (1, sizeof *inode);
+	if (inode == NULL)
+		return NULL;
+	inode->pages = calloc (page_cnt > 0 ? page_cnt : 1, sizeof *inode->pages);
+	if (inode->pages == NULL) {
+		free (inode);
+		return NULL;
+	}
+
+	inode->open_cnt = 1;
+	rwlock_init (&inode->rwlock);
+	lock_init (&inode->dir_lock);
+	inode->data.length = length;
+	inode->data.magic = INODE_MAGIC;
+
+	lock_acquire (&open_inodes_lock);
+	inode->sector = next_ram_inumber++;
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -153,19 +428,72 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-
-		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+	lock_acquire (&open_inodes_lock);
+	if (--inode->open_cnt > 0) {
+		lock_release (&open_inodes_lock);
+		return;
+	}
+
+	/* A RAM inode takes its data with it. */
+	if (inode->pages != NULL) {
+		size_t page_cnt = DIV_ROUND_UP (inode_length (inode), PGSIZE);
+		size_t i;
+
+		lock_release (&open_inodes_lock);
+		for (i = 0; i < page_cnt; i++)
+			ram_page_free (inode->pages[i]);
+		free (inode->pages);
+		free (inode);
+		return;
+	}
+
+	/* Remove from inode table and release lock. */
+	hash_delete (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+
+	inode_release_prealloc (inode);
+
+	/* Deallocate blocks if removed. */
+	if (inode->removed) {
+		size_t i;
+
+		free_map_release (inode->sector, 1);
+		for (i = 0; i < DIRECT_CNT; i++)
+			release_tree (inode->data.direct[i], 0);
+		release_tree (inode->data.indirect, 1);
+		release_tree (inode->data.doubly_indirect, 2);
+	}
+
+	free (inode); 
+}
 
-		free (inode); 
+/* Returns INODE's preallocated but unused data sectors to the
+ * free map.  inode_close() does this for the last opener. */
+void
+inode_release_prealloc (struct inode *inode) {
+	rwlock_acquire_write (&inode->rwlock);
+	if (inode->window_cnt > 0) {
+		free_map_release (inode->window_start, inode->window_cnt);
+		inode->window_cnt = 0;
 	}
+	rwlock_release_write (&inode->rwlock);
+}
+
+/* Releases the preallocated sectors of the inode that E is in. */
+static void
+release_prealloc_action (struct hash_elem *e, void *aux UNUSED) {
+	inode_release_prealloc (hash_entry (e, struct inode, elem));
+}
+
+/* Returns the preallocated but unused data sectors of every open
+ * inode to the free map, so that a free map written at shutdown
+ * does not record them as allocated.  An inode that is written
+ * again afterward reserves a new window. */
+void
+inode_release_all_prealloc (void) {
+	lock_acquire (&open_inodes_lock);
+	hash_apply (&open_inodes, release_prealloc_action);
+	lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -176,18 +504,56 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
-/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
- * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
-off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+/* Moves SIZE bytes between RAM inode INODE, starting at OFFSET,
+ * and BUFFER, writing to INODE if WRITE is true and reading from
+ * it otherwise.  The caller holds INODE's lock.
+ * Returns the number of bytes transferred, which is short at end
+ * of file or if a page cannot be allocated. */
+static off_t
+ram_io (struct inode *inode, uint8_t *buffer, off_t size, off_t offset,
+		bool write) {
+	off_t done = 0;
+
+	if (offset >= inode_length (inode))
+		return 0;
+	if (size > inode_length (inode) - offset)
+		size = inode_length (inode) - offset;
+
+	while (done < size) {
+		void **page = &inode->pages[(offset + done) / PGSIZE];
+		int page_ofs = (offset + done) % PGSIZE;
+		int chunk = size - done < PGSIZE - page_ofs
+			? size - done : PGSIZE - page_ofs;
+
+		if (write) {
+			if (*page == NULL && (*page = ram_page_alloc ()) == NULL)
+				break;
+			memcpy ((uint8_t *) *page + page_ofs, buffer + done, chunk);
+		} else if (*page == NULL)
+			memset (buffer + done, 0, chunk);
+		else
+			memcpy (buffer + done, (uint8_t *) *page + page_ofs, chunk);
+		done += chunk;
+	}
+	return done;
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position
+ * OFFSET, for a caller that holds INODE's lock. */
+static off_t
+read_at_locked (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
 
+	ASSERT (size == 0 || is_kernel_vaddr (buffer));
+	if (inode->pages != NULL)
+		return ram_io (inode, buffer, size, offset, false);
+
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		disk_sector_t sector_idx;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -200,7 +566,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+		sector_idx = byte_to_sector (inode, offset, false, NULL);
+		if (sector_idx == NO_SECTOR) {
+			/* Never written: reads as zeros without touching disk. */
+			memset (buffer + bytes_read, 0, chunk_size);
+		} else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Read full sector directly into caller's buffer. */
 			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
 		} else {
@@ -225,24 +595,40 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
+ * Returns the number of bytes actually read, which may be less
+ * than SIZE if an error occurs or end of file is reached.
+ * BUFFER must be kernel memory: it is filled while INODE's lock is
+ * held, and a page fault there could need the same lock. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) {
+	off_t bytes_read;
+
+	rwlock_acquire_read (&inode->rwlock);
+	bytes_read = read_at_locked (inode, buffer, size, offset);
+	rwlock_release_read (&inode->rwlock);
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * for a caller that holds INODE's lock for writing and has checked
+ * that writes are allowed. */
+static off_t
+write_at_locked (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
-		return 0;
+	ASSERT (size == 0 || is_kernel_vaddr (buffer));
+	inode->generation++;
+	if (inode->pages != NULL)
+		return ram_io (inode, (uint8_t *) buffer, size, offset, true);
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		disk_sector_t sector_idx;
+		bool fresh;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -255,6 +641,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
+		/* Fill the hole, if this is one. */
+		sector_idx = byte_to_sector (inode, offset, true, &fresh);
+		if (sector_idx == NO_SECTOR)
+			break;
+
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Write full sector directly to disk. */
 			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
@@ -268,8 +659,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 			/* If the sector contains data before or after the chunk
 			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
+			   first.  Otherwise, or if the sector was a hole until
+			   now, we start with a sector of all zeros. */
+			if (!fresh && (sector_ofs > 0 || chunk_size < sector_left))
 				disk_read (filesys_disk, sector_idx, bounce);
 			else
 				memset (bounce, 0, DISK_SECTOR_SIZE);
@@ -287,13 +679,191 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	return bytes_written;
 }
 
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if end of file is reached or an error occurs.
+ * BUFFER must be kernel memory, as for inode_read_at().
+ * (Normally a write at end of file would extend the inode, but
+ * growth is not yet implemented.) */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+
+	rwlock_acquire_write (&inode->rwlock);
+	if (!inode->deny_write_cnt)
+		bytes_written = write_at_locked (inode, buffer, size, offset);
+	rwlock_release_write (&inode->rwlock);
+	return bytes_written;
+}
+
+/* Sets INODE's length to LENGTH bytes.  Bytes added at the end
+ * are a hole until written.  Sectors past a shortened end stay
+ * with INODE until it is removed, and lengthening it again brings
+ * their old contents back.
+ * Returns false if LENGTH is too large or INODE lives in RAM. */
+bool
+inode_set_length (struct inode *inode, off_t length) {
+	bool success;
+
+	ASSERT (length >= 0);
+
+	rwlock_acquire_write (&inode->rwlock);
+	success = inode->pages == NULL && bytes_to_sectors (length) <= MAX_SECTORS;
+	if (success) {
+		inode->data.length = length;
+		disk_write (filesys_disk, inode->sector, &inode->data);
+	}
+	rwlock_release_write (&inode->rwlock);
+	return success;
+}
+
+/* Moves SIZE bytes between INODE, starting at sector-aligned
+ * OFFSET, and the PGSIZE-byte pages whose kernel addresses are in
+ * PAGES, writing to INODE if WRITE is true and reading from it
+ * otherwise.
+ *
+ * Whole sectors go straight between disk and pages.  Every run of
+ * sectors that is contiguous on disk becomes one
+ * disk_*_segments() call, with a segment for each page the run
+ * touches, so the disk can move it in a single command.  Only a
+ * partial last sector takes the regular, bounced path.
+ * Returns the number of bytes transferred. */
+static off_t
+direct_io (struct inode *inode, void **pages, off_t size, off_t offset,
+		bool write) {
+	struct disk_segment *segs = NULL;
+	size_t seg_cnt = 0;
+	disk_sector_t run_start = NO_SECTOR;
+	size_t run_cnt = 0;
+	off_t done = 0, full = 0;
+	bool ok = true;
+
+	ASSERT (offset % DISK_SECTOR_SIZE == 0);
+
+	if (write) {
+		rwlock_acquire_write (&inode->rwlock);
+		if (inode->deny_write_cnt) {
+			rwlock_release_write (&inode->rwlock);
+			return 0;
+		}
+		inode->generation++;
+	} else
+		rwlock_acquire_read (&inode->rwlock);
+
+	if (offset >= inode_length (inode))
+		size = 0;
+	else if (size > inode_length (inode) - offset)
+		size = inode_length (inode) - offset;
+
+	/* At most one segment per sector.  Without memory for them,
+	 * or without a disk behind INODE, everything takes the regular
+	 * path below. */
+	if (size >= DISK_SECTOR_SIZE && inode->pages == NULL) {
+		segs = malloc (size / DISK_SECTOR_SIZE * sizeof *segs);
+		if (segs != NULL)
+			full = size / DISK_SECTOR_SIZE * DISK_SECTOR_SIZE;
+	}
+
+	for (; done < full; done += DISK_SECTOR_SIZE) {
+		uint8_t *buf = (uint8_t *) pages[done / PGSIZE] + done % PGSIZE;
+		bool fresh;
+		disk_sector_t sector = byte_to_sector (inode, offset + done, write,
+				&fresh);
+
+		/* Extend the current run if this sector follows it on disk,
+		 * and its segment if it also follows in the same page. */
+		if (run_cnt > 0 && sector != NO_SECTOR
+				&& sector == run_start + run_cnt) {
+			if (done % PGSIZE != 0)
+				segs[seg_cnt - 1].cnt++;
+			else {
+				segs[seg_cnt].buffer = buf;
+				segs[seg_cnt++].cnt = 1;
+			}
+			run_cnt++;
+			continue;
+		}
+
+		/* Otherwise finish the run and start another. */
+		if (run_cnt > 0) {
+			if (write)
+				disk_write_segments (filesys_disk, run_start, segs, seg_cnt);
+			else
+				disk_read_segments (filesys_disk, run_start, segs, seg_cnt);
+		}
+		seg_cnt = run_cnt = 0;
+		if (sector == NO_SECTOR) {
+			if (write) {
+				/* Disk full. */
+				ok = false;
+				break;
+			}
+			memset (buf, 0, DISK_SECTOR_SIZE);
+			continue;
+		}
+		run_start = sector;
+		run_cnt = 1;
+		segs[0].buffer = buf;
+		segs[0].cnt = 1;
+		seg_cnt = 1;
+	}
+	if (run_cnt > 0) {
+		if (write)
+			disk_write_segments (filesys_disk, run_start, segs, seg_cnt);
+		else
+			disk_read_segments (filesys_disk, run_start, segs, seg_cnt);
+	}
+
+	if (write)
+		rwlock_release_write (&inode->rwlock);
+	else
+		rwlock_release_read (&inode->rwlock);
+	free (segs);
+
+	/* The rest, one page at a time. */
+	while (ok && done < size) {
+		off_t page_left = PGSIZE - done % PGSIZE;
+		off_t chunk = size - done < page_left ? size - done : page_left;
+		uint8_t *buf = (uint8_t *) pages[done / PGSIZE] + done % PGSIZE;
+		off_t n = write ? inode_write_at (inode, buf, chunk, offset + done)
+			: inode_read_at (inode, buf, chunk, offset + done);
+
+		done += n;
+		ok = n == chunk;
+	}
+	return done;
+}
+
+/* Reads SIZE bytes from INODE, starting at sector-aligned OFFSET,
+ * directly into the pages at kernel addresses PAGES, PGSIZE bytes
+ * per page, without a bounce buffer.
+ * Returns the number of bytes actually read. */
+off_t
+inode_read_pages (struct inode *inode, void **pages, off_t size,
+		off_t offset) {
+	return direct_io (inode, pages, size, offset, false);
+}
+
+/* Writes SIZE bytes to INODE, starting at sector-aligned OFFSET,
+ * directly from the pages at kernel addresses PAGES, as
+ * inode_read_pages().
+ * Returns the number of bytes actually written. */
+off_t
+inode_write_pages (struct inode *inode, void **pages, off_t size,
+		off_t offset) {
+	return direct_io (inode, pages, size, offset, true);
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
 inode_deny_write (struct inode *inode) 
 {
+	rwlock_acquire_write (&inode->rwlock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -301,9 +871,46 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	rwlock_acquire_write (&inode->rwlock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	rwlock_release_write (&inode->rwlock);
+}
+
+/* Acquires INODE's directory lock, which serializes lookups and
+ * updates of the directory stored in INODE. */
+void
+inode_lock_dir (struct inode *inode) {
+	lock_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void
+inode_unlock_dir (struct inode *inode) {
+	lock_release (&inode->dir_lock);
+}
+
+/* Returns INODE's write generation, which changes whenever its
+ * data is written.  A caller that keeps INODE open can compare
+ * generations to tell whether anything derived from its contents
+ * is still current. */
+unsigned
+inode_get_generation (const struct inode *inode) {
+	return inode->generation;
+}
+
+/* Returns true if INODE has been removed, so that it will be
+ * deleted once its last opener closes it. */
+bool
+inode_is_removed (const struct inode *inode) {
+	return inode->removed;
+}
+
+/* Returns true if INODE is a directory. */
+bool
+inode_is_dir (const struct inode *inode) {
+	return inode->data.is_dir != 0;
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -0,0 +1,153 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A pipe is a one-page ring buffer between the files open on its
+ * write end and those open on its read end.  Readers block while
+ * it is empty and writers while it is full.  Once every write end
+ * is closed, reads drain what is left and then return 0; once
+ * every read end is closed, writes fail. */
+
+/* Bytes of buffer in a pipe. */
+#define PIPE_SIZE PGSIZE
+
+struct pipe {
+	struct lock lock;                   /* Protects all the members. */
+	struct condition not_empty;         /* Signaled when data arrives. */
+	struct condition not_full;          /* Signaled when space frees up. */
+	uint8_t *buffer;                    /* PIPE_SIZE bytes of data. */
+	size_t head;                        /* Offset of the oldest byte. */
+	size_t used;                        /* Number of bytes buffered. */
+	int readers;                        /* Files open on the read end. */
+	int writers;                        /* Files open on the write end. */
+};
+
+/* Creates and returns a new, empty pipe with one read end and one
+ * write end open, or a null pointer if memory allocation fails.
+ * The pipe is freed when its last end is closed. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *pipe = calloc (1, sizeof *pipe);
+	if (pipe == NULL)
+		return NULL;
+	pipe->buffer = palloc_get_page (0);
+	if (pipe->buffer == NULL) {
+		free (pipe);
+		return NULL;
+	}
+	lock_init (&pipe->lock);
+	cond_init (&pipe->not_empty);
+	cond_init (&pipe->not_full);
+	pipe->readers = pipe->writers = 1;
+	return pipe;
+}
+
+/* Opens one more write end of PIPE if WRITER is true, otherwise
+ * one more read end. */
+void
+pipe_open (struct pipe *pipe, bool writer) {
+	lock_acquire (&pipe->lock);
+	if (writer)
+		pipe->writers++;
+	else
+		pipe->readers++;
+	lock_release (&pipe->lock);
+}
+
+/* Closes a write end of PIPE if WRITER is true, otherwise a read
+ * end, waking up whoever waits on the other end.  Frees PIPE if
+ * that was the last end. */
+void
+pipe_close (struct pipe *pipe, bool writer) {
+	bool last;
+
+	lock_acquire (&pipe->lock);
+	if (writer) {
+		ASSERT (pipe->writers > 0);
+		pipe->writers--;
+		cond_broadcast (&pipe->not_empty, &pipe->lock);
+	} else {
+		ASSERT (pipe->readers > 0);
+		pipe->readers--;
+		cond_broadcast (&pipe->not_full, &pipe->lock);
+	}
+	last = pipe->readers == 0 && pipe->writers == 0;
+	lock_release (&pipe->lock);
+
+	if (last) {
+		palloc_free_page (pipe->buffer);
+		free (pipe);
+	}
+}
+
+/* Reads up to SIZE bytes from PIPE into BUFFER, waiting until at
+ * least one byte is available.  Returns the number of bytes read,
+ * or 0 if PIPE is empty and has no write end open. */
+off_t
+pipe_read (struct pipe *pipe, void *buffer_, off_t size) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	lock_acquire (&pipe->lock);
+	while (pipe->used == 0 && pipe->writers > 0 && size > 0)
+		cond_wait (&pipe->not_empty, &pipe->lock);
+
+	while (bytes_read < size && pipe->used > 0) {
+		/* Copy up to the end of the data or of the buffer. */
+		size_t chunk = PIPE_SIZE - pipe->head;
+		if (chunk > pipe->used)
+			chunk = pipe->used;
+		if (chunk > (size_t) (size - bytes_read))
+			chunk = size - bytes_read;
+		memcpy (buffer + bytes_read, pipe->buffer + pipe->head, chunk);
+		pipe->head = (pipe->head + chunk) % PIPE_SIZE;
+		pipe->used -= chunk;
+		bytes_read += chunk;
+	}
+	if (bytes_read > 0)
+		cond_broadcast (&pipe->not_full, &pipe->lock);
+	lock_release (&pipe->lock);
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into PIPE, waiting for space as
+ * needed.  Returns the number of bytes written, which is less than
+ * SIZE only if the last read end is closed meanwhile, or -1 if no
+ * read end was open to begin with. */
+off_t
+pipe_write (struct pipe *pipe, const void *buffer_, off_t size) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	lock_acquire (&pipe->lock);
+	if (pipe->readers == 0) {
+		lock_release (&pipe->lock);
+		return -1;
+	}
+	while (bytes_written < size) {
+		size_t tail, chunk;
+
+		while (pipe->used == PIPE_SIZE && pipe->readers > 0)
+			cond_wait (&pipe->not_full, &pipe->lock);
+		if (pipe->readers == 0)
+			break;
+
+		/* Copy up to the end of the free space or of the buffer. */
+		tail = (pipe->head + pipe->used) % PIPE_SIZE;
+		chunk = PIPE_SIZE - pipe->used;
+		if (chunk > PIPE_SIZE - tail)
+			chunk = PIPE_SIZE - tail;
+		if (chunk > (size_t) (size - bytes_written))
+			chunk = size - bytes_written;
+		memcpy (pipe->buffer + tail, buffer + bytes_written, chunk);
+		pipe->used += chunk;
+		bytes_written += chunk;
+		cond_broadcast (&pipe->not_empty, &pipe->lock);
+	}
+	lock_release (&pipe->lock);
+	return bytes_written;
+}
@@ -0,0 +1,143 @@
+#include "filesys/tmpfs.h"
+#include <debug.h>
+#include <hash.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* The tmpfs is a flat namespace of files that live only in
+ * memory, for scratch data that need not survive a reboot.  Its
+ * files are RAM inodes (see inode_create_ram()), so once opened
+ * they go through the same `struct file' functions as files on
+ * disk.  The namespace holds one reference to each inode, which
+ * keeps its data around while no one has it open; removing the
+ * name drops that reference, and the data goes away with the
+ * last opener. */
+
+/* A named tmpfs file. */
+struct tmpfs_entry {
+	struct hash_elem elem;              /* Element in tmpfs_files. */
+	char name[NAME_MAX + 1];            /* File name. */
+	struct inode *inode;                /* The file's RAM inode. */
+};
+
+static struct hash tmpfs_files;
+static struct lock tmpfs_lock;          /* Protects tmpfs_files. */
+
+/* Returns a hash value for entry E. */
+static uint64_t
+tmpfs_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_string (hash_entry (e, struct tmpfs_entry, elem)->name);
+}
+
+/* Returns true if entry A precedes entry B. */
+static bool
+tmpfs_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return strcmp (hash_entry (a, struct tmpfs_entry, elem)->name,
+			hash_entry (b, struct tmpfs_entry, elem)->name) < 0;
+}
+
+/* Initializes the tmpfs, which starts out empty. */
+void
+tmpfs_init (void) {
+	hash_init (&tmpfs_files, tmpfs_hash, tmpfs_less, NULL);
+	lock_init (&tmpfs_lock);
+}
+
+/* If PATH names a file in the tmpfs, that is, starts with
+ * TMPFS_PREFIX, returns the file's name within the tmpfs.
+ * Otherwise returns a null pointer. */
+const char *
+tmpfs_name (const char *path) {
+	const char *prefix = TMPFS_PREFIX;
+
+	while (*prefix != '\0' && *path == *prefix)
+		path++, prefix++;
+	return *prefix == '\0' ? path : NULL;
+}
+
+/* Returns the entry named NAME, or a null pointer if there is
+ * none.  The caller must hold tmpfs_lock. */
+static struct tmpfs_entry *
+find_entry (const char *name) {
+	struct tmpfs_entry key;
+	struct hash_elem *e;
+
+	if (strlen (name) > NAME_MAX)
+		return NULL;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&tmpfs_files, &key.elem);
+	return e != NULL ? hash_entry (e, struct tmpfs_entry, elem) : NULL;
+}
+
+/* Creates a tmpfs file named NAME with the given INITIAL_SIZE.
+ * Returns true if successful, false otherwise.
+ * Fails if NAME is empty or too long, if a file named NAME
+ * already exists, or if memory allocation fails. */
+bool
+tmpfs_create (const char *name, off_t initial_size) {
+	struct tmpfs_entry *e;
+	bool success = false;
+
+	if (*name == '\0' || strlen (name) > NAME_MAX)
+		return false;
+
+	lock_acquire (&tmpfs_lock);
+	if (find_entry (name) == NULL) {
+		e = malloc (sizeof *e);
+		if (e != NULL) {
+			strlcpy (e->name, name, sizeof e->name);
+			e->inode = inode_create_ram (initial_size);
+			if (e->inode != NULL) {
+				hash_insert (&tmpfs_files, &e->elem);
+				success = true;
+			} else
+				free (e);
+		}
+	}
+	lock_release (&tmpfs_lock);
+	return success;
+}
+
+/* Opens the tmpfs file named NAME.
+ * Returns the new file if successful or a null pointer
+ * otherwise. */
+struct file *
+tmpfs_open (const char *name) {
+	struct tmpfs_entry *e;
+	struct inode *inode = NULL;
+
+	lock_acquire (&tmpfs_lock);
+	e = find_entry (name);
+	if (e != NULL)
+		inode = inode_reopen (e->inode);
+	lock_release (&tmpfs_lock);
+
+	return file_open (inode);
+}
+
+/* Deletes the tmpfs file named NAME.  Files that are open keep
+ * their data until they are closed.
+ * Returns true if successful, false if no file named NAME
+ * exists. */
+bool
+tmpfs_remove (const char *name) {
+	struct tmpfs_entry *e;
+
+	lock_acquire (&tmpfs_lock);
+	e = find_entry (name);
+	if (e != NULL)
+		hash_delete (&tmpfs_files, &e->elem);
+	lock_release (&tmpfs_lock);
+
+	if (e == NULL)
+		return false;
+	inode_remove (e->inode);
+	inode_close (e->inode);
+	free (e);
+	return true;
+}
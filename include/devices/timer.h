@@ -9,6 +9,7 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+uint64_t timer_tsc_per_tick (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
@@ -0,0 +1,22 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Result of a dentry cache probe. */
+enum dcache_result {
+	DCACHE_MISS,                /* Nothing known; read the directory. */
+	DCACHE_POSITIVE,            /* NAME exists, inode sector returned. */
+	DCACHE_NEGATIVE             /* NAME is known not to exist. */
+};
+
+void dcache_init (void);
+enum dcache_result dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp);
+void dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector, bool present);
+void dcache_invalidate (disk_sector_t parent, const char *name);
+void dcache_purge (disk_sector_t parent);
+
+#endif /* filesys/dcache.h */
@@ -1,16 +1,21 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
+#include "devices/disk.h"
 
 struct inode;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
+bool file_open_pipe (struct file **readerp, struct file **writerp);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_share (struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
+bool file_is_pipe (struct file *);
 
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
@@ -18,6 +23,19 @@ off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
 
+/* In-kernel copying. */
+off_t file_copy (struct file *dst, struct file *src, off_t size);
+off_t file_copy_from_disk (struct file *, struct disk *, disk_sector_t,
+		off_t size);
+off_t file_copy_to_disk (struct disk *, disk_sector_t, struct file *,
+		off_t size);
+
+/* Direct I/O. */
+off_t file_read_pages (struct file *, void **pages, off_t size);
+off_t file_write_pages (struct file *, void **pages, off_t size);
+void file_set_direct (struct file *, bool);
+bool file_is_direct (struct file *);
+
 /* Preventing writes. */
 void file_deny_write (struct file *);
 void file_allow_write (struct file *);
@@ -0,0 +1,18 @@
+#ifndef FILESYS_TMPFS_H
+#define FILESYS_TMPFS_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+/* Path prefix under which names belong to the tmpfs. */
+#define TMPFS_PREFIX "/tmp/"
+
+struct file;
+
+void tmpfs_init (void);
+const char *tmpfs_name (const char *path);
+bool tmpfs_create (const char *name, off_t initial_size);
+struct file *tmpfs_open (const char *name);
+bool tmpfs_remove (const char *name);
+
+#endif /* filesys/tmpfs.h */
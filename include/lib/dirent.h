@@ -0,0 +1,18 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+/* Longest name in a struct dirent, not counting the null. */
+#define DIRENT_NAME_MAX 14
+
+/* Values of d_type. */
+#define DT_REG 1                /* Regular file. */
+#define DT_DIR 2                /* Directory. */
+
+/* A directory entry, as returned by getdents(). */
+struct dirent {
+	int d_ino;                  /* Inode number. */
+	int d_type;                 /* DT_REG or DT_DIR. */
+	char d_name[DIRENT_NAME_MAX + 1];   /* Null-terminated name. */
+};
+
+#endif /* lib/dirent.h */
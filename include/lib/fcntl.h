@@ -0,0 +1,9 @@
+#ifndef __LIB_FCNTL_H
+#define __LIB_FCNTL_H
+
+/* Flags for open_flags(). */
+#define O_DIRECT 0x1            /* Move page-aligned, sector-multiple
+                                   reads and writes straight between
+                                   the disk and user memory. */
+
+#endif /* lib/fcntl.h */
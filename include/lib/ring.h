@@ -0,0 +1,55 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdint.h>
+
+/* A submission and completion queue pair that a process shares
+ * with the kernel, so that many system calls can be issued with a
+ * single kernel entry.  The process fills submission entries and
+ * advances sq_tail, then calls ring_enter(); the kernel consumes
+ * entries from sq_head, runs each one as the system call of the
+ * same name would, and posts a completion at cq_tail for each.
+ * The process consumes completions from cq_head.
+ *
+ * Head and tail indexes run freely and wrap around; an index
+ * names slot (index % RING_ENTRIES). */
+
+/* Number of slots in each queue.  A power of two. */
+#define RING_ENTRIES 128
+
+/* Operations that can be submitted. */
+enum ring_op {
+	RING_OP_NOP,                /* Do nothing; completes with 0. */
+	RING_OP_READ,               /* read (fd, addr, len). */
+	RING_OP_WRITE,              /* write (fd, addr, len). */
+	RING_OP_OPEN,               /* open_flags (addr, len). */
+	RING_OP_CLOSE,              /* close (fd). */
+	RING_OP_SEEK                /* seek (fd, len). */
+};
+
+/* A submission queue entry. */
+struct ring_sqe {
+	int opcode;                 /* One of enum ring_op. */
+	int fd;                     /* File descriptor. */
+	void *addr;                 /* Buffer or file name. */
+	unsigned len;               /* Length, flags or position. */
+	uint64_t user_data;         /* Passed back in the completion. */
+};
+
+/* A completion queue entry. */
+struct ring_cqe {
+	uint64_t user_data;         /* From the submission. */
+	int res;                    /* What the system call returned. */
+};
+
+/* The rings, which live in the process's own memory. */
+struct ring {
+	unsigned sq_head;           /* Next entry for the kernel to run. */
+	unsigned sq_tail;           /* Next entry for the process to fill. */
+	unsigned cq_head;           /* Next completion for the process. */
+	unsigned cq_tail;           /* Next completion for the kernel. */
+	struct ring_sqe sq[RING_ENTRIES];
+	struct ring_cqe cq[RING_ENTRIES];
+};
+
+#endif /* lib/ring.h */
@@ -36,6 +36,24 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_PREAD,                  /* Read from a file at an offset. */
+	SYS_PWRITE,                 /* Write to a file at an offset. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write to a file from several buffers. */
+	SYS_COPY_FILE_RANGE,        /* Copy between files inside the kernel. */
+	SYS_GETDENTS,               /* Reads many directory entries at once. */
+	SYS_RING_SETUP,             /* Registers a system call ring. */
+	SYS_RING_ENTER,             /* Runs the ring's submitted calls. */
+	SYS_PIPE,                   /* Creates a pipe. */
+	SYS_SHM_MAP,                /* Maps shared anonymous memory. */
+	SYS_SHM_UNLINK,             /* Removes a shared memory name. */
+	SYS_SPAWN,                  /* Starts a new process running a program. */
+	SYS_SYSCALL_STATS,          /* Reports per-call counts and cycles. */
+	SYS_SBRK,                   /* Moves the end of the heap. */
+
+	SYS_CNT                     /* Number of system call numbers. */
 };
 
 #endif /* lib/syscall-nr.h */
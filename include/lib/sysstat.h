@@ -0,0 +1,17 @@
+#ifndef __LIB_SYSSTAT_H
+#define __LIB_SYSSTAT_H
+
+#include <stdint.h>
+
+/* What the kernel has counted for one system call number since
+ * boot, as returned by syscall_stats().  Cycles are time stamp
+ * counter cycles spent in the kernel's handler for the call;
+ * calls that never return, such as exit, are counted but not
+ * timed. */
+struct syscall_stat {
+	uint64_t count;             /* Number of calls. */
+	uint64_t cycles;            /* Total cycles of the timed calls. */
+	uint64_t max_cycles;        /* Cycles of the longest call. */
+};
+
+#endif /* lib/sysstat.h */
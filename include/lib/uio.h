@@ -0,0 +1,15 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write. */
+struct iovec {
+	void *iov_base;             /* Start of buffer. */
+	size_t iov_len;             /* Length of buffer in bytes. */
+};
+
+/* Most buffers accepted by one readv() or writev(). */
+#define IOV_MAX 1024
+
+#endif /* lib/uio.h */
@@ -4,6 +4,12 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <uio.h>
+#include <dirent.h>
+#include <ring.h>
+#include <sysstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -25,10 +31,12 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
+pid_t spawn (const char *file, const int *fds, int fd_cnt);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
+int open_flags (const char *file, int flags);
 int filesize (int fd);
 int read (int fd, void *buffer, unsigned length);
 int write (int fd, const void *buffer, unsigned length);
@@ -37,10 +45,36 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int pipe (int fds[2]);
 
-/* Project 3 and optionally project 4. */
+/* Positional and vectored I/O. */
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int getdents (int fd, struct dirent *ents, unsigned size);
+
+/* Batched system calls. */
+int ring_setup (struct ring *ring);
+int ring_enter (unsigned to_submit);
+
+/* Kernel statistics. */
+int syscall_stats (struct syscall_stat *stats, unsigned cnt);
+
+/* Trap-free queries of the kernel data page (see lib/vdso.h). */
+int64_t clock_ticks (void);
+int64_t clock_ticks_per_sec (void);
+uint64_t clock_ns (void);
+int gettid (void);
+
+/* Project 3 and optionally project 4.
+   An FD of -1 to mmap() maps zero-filled anonymous memory. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void *sbrk (intptr_t increment);
+void *shm_map (void *addr, size_t length, const char *name);
+bool shm_unlink (const char *name);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -0,0 +1,31 @@
+#ifndef __LIB_VDSO_H
+#define __LIB_VDSO_H
+
+#include <stdint.h>
+
+/* Every process has two read-only pages mapped at VDSO_ADDR, from
+ * which it can learn the time and its own identity without a
+ * system call.  The first page, struct vdso_data, is the same
+ * physical page in every process and is kept current by the
+ * kernel.  The second page, struct vdso_proc, is the process's
+ * own.
+ *
+ * VDSO_ADDR lies just below the megabyte into which the user
+ * stack may grow down from USER_STACK. */
+#define VDSO_ADDR 0x4737e000
+#define VDSO_SIZE (2 * 4096)
+
+/* System-wide data. */
+struct vdso_data {
+	volatile int64_t ticks;     /* Timer ticks since boot. */
+	int64_t timer_freq;         /* Timer ticks per second. */
+	uint64_t tsc_per_tick;      /* TSC cycles per timer tick. */
+	uint64_t tsc_boot;          /* TSC when the page was set up. */
+};
+
+/* Per-process data. */
+struct vdso_proc {
+	int tid;                    /* The process's thread id. */
+};
+
+#endif /* lib/vdso.h */
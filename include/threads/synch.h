@@ -39,6 +39,22 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock {
+	struct lock lock;           /* Protects the fields below. */
+	struct condition can_read;  /* Signaled when readers may enter. */
+	struct condition can_write; /* Signaled when a writer may enter. */
+	int readers;                /* Number of readers holding the lock. */
+	int waiting_writers;        /* Number of writers waiting. */
+	bool writer;                /* True if a writer holds the lock. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
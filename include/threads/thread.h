@@ -29,8 +29,8 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 /* 파일 디스크립터 테이블 초기화를 위한 매크로*/
-#define FDT_PAGES 2 //fdt에 할당할 페이지 수
-#define FDT_COUNT_LIMIT 128 // fdt의 최대 크기
+#define FDT_INITIAL_SIZE 16 // 처음 open할 때 할당하는 fdt의 슬롯 수. 모자라면 두 배씩 늘린다.
+#define FDT_COUNT_LIMIT 8192 // fdt의 최대 크기
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -110,8 +110,9 @@ struct thread {
 	struct list_elem allelem; //추가한 부분. 모든 스레드들의 리스트
 
 	int exit_status;
-	struct file **fdt;//파일 디스크립터 테이블. 각 프로세스가 가지고 있는 파일 객체와 연결된 fd의 배열.
-	int next_fd;//다음에 할당할 파일 디스크립터 번호
+	struct file **fdt;//파일 디스크립터 테이블. 각 프로세스가 가지고 있는 파일 객체와 연결된 fd의 배열. 처음 open할 때 할당된다.
+	struct bitmap *fd_map;//fdt에서 사용 중인 슬롯. 0, 1(콘솔)은 항상 사용 중으로 표시된다.
+	int fdt_size;//fdt의 슬롯 수
 
 	struct intr_frame parent_if;
 	struct list child_list;
@@ -129,6 +130,7 @@ struct thread {
 	struct semaphore wait_sema;
 
 	struct file *running; // 실행 중인 파일
+	struct ring *ring; // ring_setup으로 등록한 syscall ring (유저 메모리). 없으면 NULL
 
 
 #ifdef USERPROG 
@@ -139,6 +141,8 @@ struct thread {
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;//추가한 부분
 	void *rsp;//추가한 부분
+	void *heap_start; // 실행 파일의 마지막 세그먼트 끝. sbrk로 늘리는 heap이 여기서 시작한다.
+	void *heap_end;   // 현재 heap의 끝(break)
 #endif
 
 	/* Owned by thread.c. */
@@ -5,8 +5,14 @@
 #include "filesys/off_t.h"
 
 bool lazy_load_segment(struct page *page, void *aux);
+void segment_aux_hold(bool (*init)(struct page *, void *), void *aux);
+void segment_aux_release(bool (*init)(struct page *, void *), void *aux);
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (char *cmd_line, struct file **files, int file_cnt);
+void elf_cache_init (void);
+void elf_cache_purge (void);
+void elf_cache_flush (void);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -26,6 +32,7 @@ struct thread *get_child_process(int pid);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
 void process_close_file(int fd);
+bool process_set_file(int fd, struct file *f);
 struct thread *get_child_process(int pid);
 
 struct lazy_load_arg //추가한 부분
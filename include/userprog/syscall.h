@@ -1,7 +1,6 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
-#include "threads/synch.h"
 
 void syscall_init (void);
-struct lock filesys_lock;//file system을 위한 lock
+void syscall_print_stats (void);
 #endif /* userprog/syscall.h */
@@ -10,5 +10,8 @@ struct anon_page {
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool swap_read (uint32_t slot_no, void *kva);
+uint32_t swap_write (struct page *page, void *kva);
+void swap_free (uint32_t slot_no);
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <list.h>
+#include <stddef.h>
+#include "vm/vm.h"
+
+struct page;
+struct shm;
+enum vm_type;
+
+/* 공유 메모리 객체 이름의 최대 길이. */
+#define SHM_NAME_MAX 14
+
+struct shm_page {
+	struct shm *shm;              // 매핑한 공유 메모리 객체
+	size_t idx;                   // 객체 안에서 몇 번째 페이지인지
+	uint64_t *pml4;               // 이 page가 매핑된 페이지 테이블
+	struct list_elem mapper_elem; // 같은 페이지를 매핑한 page들의 목록
+};
+
+void vm_shm_init (void);
+bool shm_initializer (struct page *page, enum vm_type type, void *kva);
+void *shm_map (void *addr, size_t length, const char *name);
+bool shm_map_page (void *upage, struct shm *shm, size_t idx);
+bool shm_unlink (const char *name);
+
+#endif
@@ -14,6 +14,8 @@ enum vm_type
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page shared with other processes, see vm/shm.c */
+	VM_SHM = 4,
 
 	/* Bit flags to store state */
 
@@ -29,6 +31,7 @@ enum vm_type
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -60,6 +63,7 @@ struct page
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shm_page shm;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -72,6 +76,8 @@ struct frame
 	void *kva;
 	struct page *page;
 	struct list_elem frame_elem; // frame_table을 위한 list_elem
+	bool pinned;				 // direct I/O 중이거나 쫓아내거나 채우는 중이라 eviction하면 안 되는 frame
+	int ref_cnt;				 // 이 frame을 매핑한 page 수 (공유 메모리 frame은 여러 page가 매핑한다)
 };
 struct slot
 {
@@ -126,6 +132,10 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 									bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page(struct page *page);
 bool vm_claim_page(void *va);
+void *vm_pin_page(void *va, bool write);
+void vm_unpin_page(void *va);
+bool vm_alloc_anon(void *va, size_t page_cnt, bool writable);
+void vm_release_pages(void *va, size_t page_cnt);
 enum vm_type page_get_type(struct page *page);
 void hash_page_destroy(struct hash_elem *e, void *aux);
 
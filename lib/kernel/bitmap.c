@@ -272,6 +272,23 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 1) {
+		/* Looking for a single bit: skip over whole elements that
+		   hold no bit set to VALUE.  Bits past the end of the last
+		   element are always 0, so they can match only when VALUE
+		   is false, and they are then past bit_cnt. */
+		size_t i;
+		for (i = start; i < b->bit_cnt; i = (elem_idx (i) + 1) * ELEM_BITS) {
+			elem_type e = value ? b->bits[elem_idx (i)] : ~b->bits[elem_idx (i)];
+			e &= (elem_type) -1 << (i % ELEM_BITS);
+			if (e != 0) {
+				size_t idx = elem_idx (i) * ELEM_BITS + __builtin_ctzl (e);
+				return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+			}
+		}
+		return BITMAP_ERROR;
+	}
+
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
 		size_t i;
@@ -326,6 +343,21 @@ bitmap_write (const struct bitmap *b, struct file *file) {
 	off_t size = byte_cnt (b->bit_cnt);
 	return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes at byte offset OFS of B's file image to
+   the same offset in FILE, clipped to the end of the image.
+   Returns true if successful, false otherwise. */
+bool
+bitmap_write_range (const struct bitmap *b, struct file *file,
+		size_t ofs, size_t size) {
+	size_t file_size = byte_cnt (b->bit_cnt);
+	if (ofs >= file_size)
+		return true;
+	if (size > file_size - ofs)
+		size = file_size - ofs;
+	return file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs)
+		== (off_t) size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -0,0 +1,252 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A user-space malloc() on top of sbrk().
+
+   Requests of up to MAX_BLOCK bytes are rounded up to a power
+   of 2, starting at 16, and served from that size class's free
+   list.  When the list is empty, a one-page "arena" is carved
+   into blocks of that size and all of them are added to the
+   list.  Freeing a small block just pushes it back on its list,
+   so the common malloc()/free() pair never enters the kernel.
+   Small arenas are never given back.
+
+   Larger requests get a run of whole pages with the arena
+   header at its start.  Freed runs go on a first-fit list and
+   are split to serve later runs or new small arenas.  A freed
+   run that ends at the break is returned to the kernel with a
+   negative sbrk(), along with any free runs it uncovers.
+
+   User processes have a single thread, so the free lists are
+   simply per-process and need no locking. */
+
+#define PAGE_SIZE 4096
+#define MAX_BLOCK 1024              /* Largest small block. */
+#define CLASS_CNT 7                 /* Size classes 16 ... MAX_BLOCK. */
+#define CLASS_RUN CLASS_CNT         /* Arena class for a run of pages. */
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x6d616c6c
+
+/* Arena.  Its size keeps the blocks 16-byte aligned. */
+struct arena {
+	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	unsigned class;             /* Size class, or CLASS_RUN. */
+	size_t page_cnt;            /* Pages in the arena. */
+};
+
+/* Free block. */
+struct block {
+	struct block *next;         /* Next free block of the same class. */
+};
+
+/* Free run of pages. */
+struct run {
+	struct arena arena;
+	struct run *next;           /* Next free run. */
+};
+
+static struct block *free_blocks[CLASS_CNT];
+static struct run *free_runs;
+
+/* Returns the size of the blocks in size class CLASS. */
+static size_t
+class_size (unsigned class) {
+	return (size_t) 16 << class;
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (void *b) {
+	struct arena *a = (struct arena *) ((uintptr_t) b & ~(uintptr_t) (PAGE_SIZE - 1));
+	ASSERT (a->magic == ARENA_MAGIC);
+	ASSERT (a->class <= CLASS_RUN);
+	return a;
+}
+
+/* Obtains PAGE_CNT contiguous pages, reusing a free run if one
+   is big enough and growing the heap otherwise.  Returns a null
+   pointer if the heap cannot grow. */
+static void *
+get_pages (size_t page_cnt) {
+	struct run **rp;
+	for (rp = &free_runs; *rp != NULL; rp = &(*rp)->next) {
+		struct run *r = *rp;
+		if (r->arena.page_cnt == page_cnt) {
+			*rp = r->next;
+			return r;
+		}
+		if (r->arena.page_cnt > page_cnt) {
+			/* Hand out the tail so the run stays in place. */
+			r->arena.page_cnt -= page_cnt;
+			return (uint8_t *) r + r->arena.page_cnt * PAGE_SIZE;
+		}
+	}
+
+	/* The break starts right after the program's data, so the
+	   first call has to pad it to a page boundary. */
+	uintptr_t brk = (uintptr_t) sbrk (0);
+	size_t pad = ROUND_UP (brk, PAGE_SIZE) - brk;
+	if (page_cnt > (SIZE_MAX - pad) / PAGE_SIZE)
+		return NULL;
+	uint8_t *p = sbrk (pad + page_cnt * PAGE_SIZE);
+	if (p == (void *) -1)
+		return NULL;
+	return p + pad;
+}
+
+/* Takes back PAGE_CNT pages starting at A. */
+static void
+put_pages (struct arena *a, size_t page_cnt) {
+	uint8_t *brk = sbrk (0);
+	if ((uint8_t *) a + page_cnt * PAGE_SIZE != brk) {
+		struct run *r = (struct run *) a;
+		r->arena.magic = ARENA_MAGIC;
+		r->arena.class = CLASS_RUN;
+		r->arena.page_cnt = page_cnt;
+		r->next = free_runs;
+		free_runs = r;
+		return;
+	}
+
+	/* The run is at the top of the heap.  Give it back, then keep
+	   going while the new top is also free. */
+	for (;;) {
+		sbrk (-(intptr_t) (page_cnt * PAGE_SIZE));
+		brk = (uint8_t *) a;
+
+		struct run **rp;
+		for (rp = &free_runs; *rp != NULL; rp = &(*rp)->next)
+			if ((uint8_t *) *rp + (*rp)->arena.page_cnt * PAGE_SIZE == brk)
+				break;
+		if (*rp == NULL)
+			break;
+		a = &(*rp)->arena;
+		page_cnt = a->page_cnt;
+		*rp = (*rp)->next;
+	}
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	/* Handle too-big requests with a run of pages. */
+	if (size > MAX_BLOCK) {
+		if (size > SIZE_MAX - sizeof (struct arena) - PAGE_SIZE)
+			return NULL;
+		size_t page_cnt = DIV_ROUND_UP (size + sizeof (struct arena), PAGE_SIZE);
+		struct arena *a = get_pages (page_cnt);
+		if (a == NULL)
+			return NULL;
+		a->magic = ARENA_MAGIC;
+		a->class = CLASS_RUN;
+		a->page_cnt = page_cnt;
+		return a + 1;
+	}
+
+	/* Find the smallest size class that satisfies the request. */
+	unsigned class = 0;
+	while (class_size (class) < size)
+		class++;
+
+	/* If the free list is empty, carve a new arena into blocks. */
+	if (free_blocks[class] == NULL) {
+		struct arena *a = get_pages (1);
+		if (a == NULL)
+			return NULL;
+		a->magic = ARENA_MAGIC;
+		a->class = class;
+		a->page_cnt = 1;
+
+		uint8_t *b;
+		for (b = (uint8_t *) (a + 1);
+				b + class_size (class) <= (uint8_t *) a + PAGE_SIZE;
+				b += class_size (class)) {
+			struct block *blk = (struct block *) b;
+			blk->next = free_blocks[class];
+			free_blocks[class] = blk;
+		}
+	}
+
+	struct block *b = free_blocks[class];
+	free_blocks[class] = b->next;
+	return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	/* Calculate block size and make sure it fits in size_t. */
+	size_t size = a * b;
+	if (b != 0 && size / b != a)
+		return NULL;
+
+	void *p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+	return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) {
+	struct arena *a = block_to_arena (block);
+	if (a->class == CLASS_RUN)
+		return a->page_cnt * PAGE_SIZE - sizeof *a;
+	return class_size (a->class);
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.  If successful, returns the new
+   block; on failure, returns a null pointer.  A call with null
+   OLD_BLOCK is equivalent to malloc(NEW_SIZE).  A call with
+   zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	}
+	if (old_block == NULL)
+		return malloc (new_size);
+
+	size_t old_size = block_size (old_block);
+	if (new_size <= old_size)
+		return old_block;
+
+	void *new_block = malloc (new_size);
+	if (new_block != NULL) {
+		memcpy (new_block, old_block, old_size);
+		free (old_block);
+	}
+	return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	if (p == NULL)
+		return;
+
+	struct arena *a = block_to_arena (p);
+	if (a->class == CLASS_RUN) {
+		ASSERT (p == a + 1);
+		put_pages (a, a->page_cnt);
+		return;
+	}
+
+	struct block *b = p;
+	b->next = free_blocks[a->class];
+	free_blocks[a->class] = b;
+}
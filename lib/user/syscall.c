@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -90,6 +90,11 @@ exec (const char *file) {
 	return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
+pid_t
+spawn (const char *file, const int *fds, int fd_cnt) {
+	return (pid_t) syscall3 (SYS_SPAWN, file, fds, fd_cnt);
+}
+
 int
 wait (pid_t pid) {
 	return syscall1 (SYS_WAIT, pid);
@@ -107,7 +112,12 @@ remove (const char *file) {
 
 int
 open (const char *file) {
-	return syscall1 (SYS_OPEN, file);
+	return syscall2 (SYS_OPEN, file, 0);
+}
+
+int
+open_flags (const char *file, int flags) {
+	return syscall2 (SYS_OPEN, file, flags);
 }
 
 int
@@ -155,6 +165,21 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+void *
+sbrk (intptr_t increment) {
+	return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+void *
+shm_map (void *addr, size_t length, const char *name) {
+	return (void *) syscall3 (SYS_SHM_MAP, addr, length, name);
+}
+
+bool
+shm_unlink (const char *name) {
+	return syscall1 (SYS_SHM_UNLINK, name);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -194,3 +219,53 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+pread (int fd, void *buffer, unsigned length, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length) {
+	return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+int
+getdents (int fd, struct dirent *ents, unsigned size) {
+	return syscall3 (SYS_GETDENTS, fd, ents, size);
+}
+
+int
+ring_setup (struct ring *ring) {
+	return syscall1 (SYS_RING_SETUP, ring);
+}
+
+int
+ring_enter (unsigned to_submit) {
+	return syscall1 (SYS_RING_ENTER, to_submit);
+}
+
+int
+syscall_stats (struct syscall_stat *stats, unsigned cnt) {
+	return syscall2 (SYS_SYSCALL_STATS, stats, cnt);
+}
+
+int
+pipe (int fds[2]) {
+	return syscall1 (SYS_PIPE, fds);
+}
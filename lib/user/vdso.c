@@ -0,0 +1,49 @@
+#include <syscall.h>
+#include <vdso.h>
+
+/* These read the kernel data pages mapped at VDSO_ADDR, so they
+ * cost no more than a memory load and never enter the kernel.
+ * See lib/vdso.h. */
+
+static const volatile struct vdso_data *const data =
+	(const struct vdso_data *) VDSO_ADDR;
+static const struct vdso_proc *const proc =
+	(const struct vdso_proc *) (VDSO_ADDR + 4096);
+
+/* Returns the time stamp counter. */
+static inline uint64_t
+rdtsc (void) {
+	uint32_t lo, hi;
+	asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+clock_ticks (void) {
+	return data->ticks;
+}
+
+/* Returns the number of timer ticks per second. */
+int64_t
+clock_ticks_per_sec (void) {
+	return data->timer_freq;
+}
+
+/* Returns the number of nanoseconds since the kernel data page was
+ * set up during boot, measured with the time stamp counter. */
+uint64_t
+clock_ns (void) {
+	uint64_t hz = data->tsc_per_tick * data->timer_freq;
+	uint64_t cycles = rdtsc () - data->tsc_boot;
+
+	if (hz == 0)
+		return data->ticks * (1000000000 / data->timer_freq);
+	return cycles / hz * 1000000000 + cycles % hz * 1000000000 / hz;
+}
+
+/* Returns the calling process's thread id. */
+int
+gettid (void) {
+	return proc->tid;
+}
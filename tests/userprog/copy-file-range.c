@@ -0,0 +1,32 @@
+/* Copies "sample.txt" into another file with copy_file_range(),
+   which must advance both file positions, and verifies the
+   copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  const int size = sizeof sample - 1;
+  int in, out;
+
+  CHECK (create ("copy", size), "create \"copy\"");
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out = open ("copy")) > 1, "open \"copy\"");
+  CHECK (copy_file_range (in, out, size) == size,
+         "copy \"sample.txt\" to \"copy\"");
+  CHECK ((int) tell (in) == size && (int) tell (out) == size,
+         "both file positions advanced");
+  CHECK (copy_file_range (in, out, 10) == 0,
+         "copy at end of file returns 0");
+  CHECK (copy_file_range (in, 0x1234, 10) == -1,
+         "copy to a bad fd fails");
+  msg ("close \"sample.txt\"");
+  close (in);
+  msg ("close \"copy\"");
+  close (out);
+  check_file ("copy", sample, size);
+}
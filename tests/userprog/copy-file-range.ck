@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "copy"
+(copy-file-range) open "sample.txt"
+(copy-file-range) open "copy"
+(copy-file-range) copy "sample.txt" to "copy"
+(copy-file-range) both file positions advanced
+(copy-file-range) copy at end of file returns 0
+(copy-file-range) copy to a bad fd fails
+(copy-file-range) close "sample.txt"
+(copy-file-range) close "copy"
+(copy-file-range) open "copy" for verification
+(copy-file-range) verified contents of "copy"
+(copy-file-range) close "copy"
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
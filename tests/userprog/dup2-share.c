@@ -0,0 +1,41 @@
+/* Writes through a file descriptor and its dup2() copy, in the
+   parent and then in a forked child, and checks that each pair
+   shares one file position so the writes are concatenated. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[16];
+  int fd, status;
+  pid_t pid;
+
+  CHECK (create ("shared", 0), "create \"shared\"");
+  CHECK ((fd = open ("shared")) > 1, "open \"shared\"");
+  CHECK (dup2 (fd, 5) == 5, "dup2 onto fd 5");
+  CHECK (write (fd, "abc", 3) == 3, "write \"abc\" through the old fd");
+  CHECK (write (5, "def", 3) == 3, "write \"def\" through fd 5");
+  CHECK (tell (fd) == 6 && tell (5) == 6, "both fds at offset 6");
+
+  pid = fork ("dup2-child");
+  if (pid == 0)
+    {
+      write (fd, "ghi", 3);
+      write (5, "jkl", 3);
+      exit (tell (fd));
+    }
+  status = wait (pid);
+  CHECK (status == 12, "child's fds share one position");
+  close (fd);
+  close (5);
+
+  CHECK ((fd = open ("shared")) > 1, "reopen \"shared\"");
+  memset (buf, 0, sizeof buf);
+  CHECK (read (fd, buf, sizeof buf) == 12 && !strcmp (buf, "abcdefghijkl"),
+         "read \"abcdefghijkl\"");
+  close (fd);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup2-share) begin
+(dup2-share) create "shared"
+(dup2-share) open "shared"
+(dup2-share) dup2 onto fd 5
+(dup2-share) write "abc" through the old fd
+(dup2-share) write "def" through fd 5
+(dup2-share) both fds at offset 6
+dup2-child: exit(12)
+(dup2-share) child's fds share one position
+(dup2-share) reopen "shared"
+(dup2-share) read "abcdefghijkl"
+(dup2-share) end
+dup2-share: exit(0)
+EOF
+pass;
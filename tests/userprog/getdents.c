@@ -0,0 +1,41 @@
+/* Creates two files, then reads the root directory with
+   getdents() a few entries at a time and finds both, as regular
+   files. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct dirent ents[3];
+  int found = 0;
+  int fd, n, i;
+
+  CHECK (create ("alpha", 0), "create \"alpha\"");
+  CHECK (create ("beta", 0), "create \"beta\"");
+  CHECK ((fd = open ("/")) > 1, "open \"/\"");
+  while ((n = getdents (fd, ents, sizeof ents)) > 0)
+    for (i = 0; i < n; i++)
+      {
+        if (!strcmp (ents[i].d_name, "alpha") && ents[i].d_type == DT_REG)
+          found |= 1;
+        if (!strcmp (ents[i].d_name, "beta") && ents[i].d_type == DT_REG)
+          found |= 2;
+      }
+  CHECK (n == 0, "getdents reached the end of \"/\"");
+  CHECK (found == 3, "found \"alpha\" and \"beta\"");
+  CHECK (getdents (fd, ents, sizeof ents) == 0,
+         "getdents at the end returns 0");
+  CHECK (getdents (fd, ents, sizeof ents[0] - 1) == -1,
+         "getdents into a buffer smaller than one entry fails");
+  msg ("close \"/\"");
+  close (fd);
+
+  CHECK ((fd = open ("alpha")) > 1, "open \"alpha\"");
+  CHECK (getdents (fd, ents, sizeof ents) == -1, "getdents on a file fails");
+  msg ("close \"alpha\"");
+  close (fd);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getdents) begin
+(getdents) create "alpha"
+(getdents) create "beta"
+(getdents) open "/"
+(getdents) getdents reached the end of "/"
+(getdents) found "alpha" and "beta"
+(getdents) getdents at the end returns 0
+(getdents) getdents into a buffer smaller than one entry fails
+(getdents) close "/"
+(getdents) open "alpha"
+(getdents) getdents on a file fails
+(getdents) close "alpha"
+(getdents) end
+getdents: exit(0)
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Checks that a pipe's reader gets end of file once every write
+   end is closed: after a forked writer exits, and after the read
+   end has been moved onto fd 0 with dup2(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[16];
+  int fds[2];
+  int status;
+  pid_t pid;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pid = fork ("pipe-writer");
+  if (pid == 0)
+    {
+      close (fds[0]);
+      write (fds[1], "hello", 5);
+      exit (0);
+    }
+  close (fds[1]);
+  status = wait (pid);
+  CHECK (status == 0, "wait for writer");
+  CHECK (read (fds[0], buf, sizeof buf) == 5 && !memcmp (buf, "hello", 5),
+         "read \"hello\"");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read at end of file returns 0");
+  close (fds[0]);
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], "abc", 3) == 3, "write \"abc\"");
+  CHECK (write (fds[0], "abc", 3) == -1, "write to the read end fails");
+  CHECK (read (fds[1], buf, 3) == -1, "read from the write end fails");
+  CHECK (dup2 (fds[0], 0) == 0, "dup2 the read end onto fd 0");
+  close (fds[0]);
+  close (fds[1]);
+  CHECK (read (0, buf, sizeof buf) == 3 && !memcmp (buf, "abc", 3),
+         "read \"abc\" from fd 0");
+  CHECK (read (0, buf, sizeof buf) == 0, "read at end of file returns 0");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-eof) begin
+(pipe-eof) pipe
+pipe-writer: exit(0)
+(pipe-eof) wait for writer
+(pipe-eof) read "hello"
+(pipe-eof) read at end of file returns 0
+(pipe-eof) pipe
+(pipe-eof) write "abc"
+(pipe-eof) write to the read end fails
+(pipe-eof) read from the write end fails
+(pipe-eof) dup2 the read end onto fd 0
+(pipe-eof) read "abc" from fd 0
+(pipe-eof) read at end of file returns 0
+(pipe-eof) end
+pipe-eof: exit(0)
+EOF
+pass;
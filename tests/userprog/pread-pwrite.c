@@ -0,0 +1,31 @@
+/* Reads and writes at explicit offsets with pread() and pwrite(),
+   which must leave the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[8];
+  int fd;
+
+  CHECK (create ("positional", 16), "create \"positional\"");
+  CHECK ((fd = open ("positional")) > 1, "open \"positional\"");
+  CHECK (pwrite (fd, "world", 5, 6) == 5, "pwrite \"world\" at offset 6");
+  CHECK (pwrite (fd, "hello", 5, 0) == 5, "pwrite \"hello\" at offset 0");
+  CHECK (tell (fd) == 0, "file position is still 0");
+  CHECK (pread (fd, buf, 5, 6) == 5 && !memcmp (buf, "world", 5),
+         "pread \"world\" at offset 6");
+  CHECK (pread (fd, buf, 5, 0) == 5 && !memcmp (buf, "hello", 5),
+         "pread \"hello\" at offset 0");
+  CHECK (pread (fd, buf, sizeof buf, 12) == 4,
+         "pread across end of file returns 4");
+  CHECK (pread (fd, buf, sizeof buf, -1) == -1,
+         "pread at a negative offset fails");
+  CHECK (tell (fd) == 0, "file position is still 0");
+  msg ("close \"positional\"");
+  close (fd);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "positional"
+(pread-pwrite) open "positional"
+(pread-pwrite) pwrite "world" at offset 6
+(pread-pwrite) pwrite "hello" at offset 0
+(pread-pwrite) file position is still 0
+(pread-pwrite) pread "world" at offset 6
+(pread-pwrite) pread "hello" at offset 0
+(pread-pwrite) pread across end of file returns 4
+(pread-pwrite) pread at a negative offset fails
+(pread-pwrite) file position is still 0
+(pread-pwrite) close "positional"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Passes readv() an iovec whose second buffer is in kernel
+   memory, after a valid one.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[4];
+  struct iovec iov[2] = {{buf, sizeof buf}, {(char *) 0x8004000000, 4}};
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  readv (handle, iov, 2);
+  fail ("should not have survived readv()");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-bad-iov) begin
+(readv-bad-iov) open "sample.txt"
+readv-bad-iov: exit(-1)
+EOF
+pass;
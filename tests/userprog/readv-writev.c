@@ -0,0 +1,35 @@
+/* Writes three buffers, with an empty one among them, in one
+   writev() and reads them back into two buffers of other sizes
+   in one readv(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char a[] = "Hello, ", b[] = "vectored ", c[] = "world";
+  char x[10], y[11];
+  struct iovec wv[4] = {{a, 7}, {NULL, 0}, {b, 9}, {c, 5}};
+  struct iovec rv[2] = {{x, sizeof x}, {y, sizeof y}};
+  int fd;
+
+  CHECK (create ("vector", 21), "create \"vector\"");
+  CHECK ((fd = open ("vector")) > 1, "open \"vector\"");
+  CHECK (writev (fd, wv, 4) == 21, "writev 4 buffers");
+  CHECK (tell (fd) == 21, "file position is 21");
+
+  seek (fd, 0);
+  CHECK (readv (fd, rv, 2) == 21, "readv into 2 buffers");
+  CHECK (!memcmp (x, "Hello, vec", 10) && !memcmp (y, "tored world", 11),
+         "read back what was written");
+  CHECK (readv (fd, rv, 2) == 0, "readv at end of file returns 0");
+
+  CHECK (writev (fd, wv, 0) == -1, "writev of 0 buffers fails");
+  CHECK (writev (fd, wv, IOV_MAX + 1) == -1,
+         "writev of more than IOV_MAX buffers fails");
+  msg ("close \"vector\"");
+  close (fd);
+}
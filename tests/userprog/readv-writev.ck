@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "vector"
+(readv-writev) open "vector"
+(readv-writev) writev 4 buffers
+(readv-writev) file position is 21
+(readv-writev) readv into 2 buffers
+(readv-writev) read back what was written
+(readv-writev) readv at end of file returns 0
+(readv-writev) writev of 0 buffers fails
+(readv-writev) writev of more than IOV_MAX buffers fails
+(readv-writev) close "vector"
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Opens, writes, rereads and closes a file through the syscall
+   ring, several operations per ring_enter(), and checks every
+   completion. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+/* Queues one submission. */
+static void
+submit (int opcode, int fd, void *addr, unsigned len, uint64_t user_data)
+{
+  struct ring_sqe *sqe = &ring.sq[ring.sq_tail % RING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Takes the next completion, which must be for USER_DATA, and
+   returns its result. */
+static int
+reap (uint64_t user_data)
+{
+  struct ring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("completion queue is empty");
+  cqe = &ring.cq[ring.cq_head++ % RING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for %d arrived out of order", (int) user_data);
+  return cqe->res;
+}
+
+void
+test_main (void)
+{
+  char name[] = "ringfile";
+  char data[] = "0123456789";
+  char buf[10];
+  int fd;
+
+  CHECK (ring_enter (1) == -1, "ring_enter without a ring fails");
+  CHECK (create (name, 10), "create \"%s\"", name);
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  submit (RING_OP_OPEN, 0, name, 0, 1);
+  CHECK (ring_enter (1) == 1, "submit open");
+  CHECK ((fd = reap (1)) > 1, "open completed");
+
+  submit (RING_OP_WRITE, fd, data, 10, 2);
+  submit (RING_OP_SEEK, fd, NULL, 0, 3);
+  submit (RING_OP_READ, fd, buf, 10, 4);
+  submit (RING_OP_CLOSE, fd, NULL, 0, 5);
+  submit (RING_OP_NOP, 0, NULL, 0, 6);
+  submit (-1, 0, NULL, 0, 7);
+  CHECK (ring_enter (6) == 6, "submit 6 operations");
+  CHECK (reap (2) == 10, "write completed");
+  CHECK (reap (3) == 0, "seek completed");
+  CHECK (reap (4) == 10 && !memcmp (buf, data, 10),
+         "read completed with the written data");
+  CHECK (reap (5) == 0, "close completed");
+  CHECK (reap (6) == 0, "nop completed");
+  CHECK (reap (7) == -1, "unknown operation failed");
+  CHECK (ring_enter (1) == 0, "ring_enter with nothing queued returns 0");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring) begin
+(ring) ring_enter without a ring fails
+(ring) create "ringfile"
+(ring) ring_setup
+(ring) submit open
+(ring) open completed
+(ring) submit 6 operations
+(ring) write completed
+(ring) seek completed
+(ring) read completed with the written data
+(ring) close completed
+(ring) nop completed
+(ring) unknown operation failed
+(ring) ring_enter with nothing queued returns 0
+(ring) end
+ring: exit(0)
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Starts child-simple with spawn(), first with all of our file
+   descriptors and then with its fd 1 mapped to a pipe, which must
+   then hold the child's output. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[64];
+  int map[2], fds[2];
+  int status, len, n;
+  pid_t pid;
+
+  msg ("wait(spawn()) = %d", wait (spawn ("child-simple", NULL, 0)));
+
+  CHECK (pipe (fds) == 0, "pipe");
+  map[0] = -1;
+  map[1] = fds[1];
+  pid = spawn ("child-simple", map, 2);
+  close (fds[1]);
+  status = wait (pid);
+  CHECK (status == 81, "child-simple writing to a pipe exited with 81");
+
+  len = 0;
+  while ((n = read (fds[0], buf + len, sizeof buf - 1 - len)) > 0)
+    len += n;
+  buf[len] = '\0';
+  CHECK (!strcmp (buf, "(child-simple) run\n"),
+         "pipe holds the child's output");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn) begin
+(child-simple) run
+child-simple: exit(81)
+(spawn) wait(spawn()) = 81
+(spawn) pipe
+child-simple: exit(81)
+(spawn) child-simple writing to a pipe exited with 81
+(spawn) pipe holds the child's output
+(spawn) end
+spawn: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Makes a known number of tell() calls and checks that the
+   kernel's per-call statistics count exactly those. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct syscall_stat before[SYS_CNT], after[SYS_CNT];
+
+void
+test_main (void)
+{
+  const struct syscall_stat *b = &before[SYS_TELL], *a = &after[SYS_TELL];
+  int i;
+
+  CHECK (syscall_stats (before, SYS_CNT) == SYS_CNT,
+         "syscall_stats returns SYS_CNT");
+  for (i = 0; i < 10; i++)
+    tell (0);
+  syscall_stats (after, SYS_CNT);
+
+  CHECK (a->count - b->count == 10, "10 tell() calls counted");
+  CHECK (a->cycles > b->cycles && a->max_cycles <= a->cycles,
+         "tell() cycles accumulated");
+  CHECK (after[SYS_SYSCALL_STATS].count - before[SYS_SYSCALL_STATS].count
+         == 1, "syscall_stats counted itself once");
+  CHECK (syscall_stats (after, 1) == SYS_CNT,
+         "syscall_stats into a short buffer returns SYS_CNT");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-stats) begin
+(syscall-stats) syscall_stats returns SYS_CNT
+(syscall-stats) 10 tell() calls counted
+(syscall-stats) tell() cycles accumulated
+(syscall-stats) syscall_stats counted itself once
+(syscall-stats) syscall_stats into a short buffer returns SYS_CNT
+(syscall-stats) end
+syscall-stats: exit(0)
+EOF
+pass;
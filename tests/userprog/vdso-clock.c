@@ -0,0 +1,39 @@
+/* Reads the clocks and the thread id from the vDSO pages, which
+   must track the kernel without any system call: the tick count
+   and nanosecond clock advance, and a child sees its own id. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int64_t start;
+  uint64_t ns;
+  int fds[2];
+  int tid, status;
+  pid_t pid;
+
+  CHECK (clock_ticks_per_sec () == 100, "clock_ticks_per_sec is 100");
+  start = clock_ticks ();
+  ns = clock_ns ();
+  while (clock_ticks () < start + 2)
+    continue;
+  msg ("clock_ticks advanced");
+  CHECK (clock_ns () > ns, "clock_ns advanced");
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pid = fork ("vdso-child");
+  if (pid == 0)
+    {
+      tid = gettid ();
+      write (fds[1], &tid, sizeof tid);
+      exit (0);
+    }
+  status = wait (pid);
+  CHECK (status == 0, "wait for child");
+  CHECK (read (fds[0], &tid, sizeof tid) == (int) sizeof tid && tid == pid,
+         "child's gettid() is its pid");
+  CHECK (gettid () != pid, "parent's gettid() is not the child's");
+}
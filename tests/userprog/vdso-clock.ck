@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vdso-clock) begin
+(vdso-clock) clock_ticks_per_sec is 100
+(vdso-clock) clock_ticks advanced
+(vdso-clock) clock_ns advanced
+(vdso-clock) pipe
+vdso-child: exit(0)
+(vdso-clock) wait for child
+(vdso-clock) child's gettid() is its pid
+(vdso-clock) parent's gettid() is not the child's
+(vdso-clock) end
+vdso-clock: exit(0)
+EOF
+pass;
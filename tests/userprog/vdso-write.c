@@ -0,0 +1,18 @@
+/* Tries to read file data into the vDSO data page, which is
+   read-only and shared by every process.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include <vdso.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  read (handle, (void *) VDSO_ADDR, 16);
+  fail ("survived reading data into the vDSO page");
+}
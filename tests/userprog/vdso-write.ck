@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vdso-write) begin
+(vdso-write) open "sample.txt"
+vdso-write: exit(-1)
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Tries to change a directory through every system call that
+   writes file data.  Each one must fail with -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+void
+test_main (void)
+{
+  char buf[] = "garbage";
+  struct iovec iov = {buf, sizeof buf};
+  struct ring_sqe *sqe;
+  int dir, src;
+
+  CHECK ((dir = open ("/")) > 1, "open \"/\"");
+  CHECK (write (dir, buf, sizeof buf) == -1, "write fails");
+  CHECK (pwrite (dir, buf, sizeof buf, 0) == -1, "pwrite fails");
+  CHECK (writev (dir, &iov, 1) == -1, "writev fails");
+
+  CHECK ((src = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (copy_file_range (src, dir, 10) == -1, "copy_file_range fails");
+
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+  sqe = &ring.sq[ring.sq_tail++ % RING_ENTRIES];
+  sqe->opcode = RING_OP_WRITE;
+  sqe->fd = dir;
+  sqe->addr = buf;
+  sqe->len = sizeof buf;
+  CHECK (ring_enter (1) == 1 && ring.cq[0].res == -1,
+         "RING_OP_WRITE fails");
+}
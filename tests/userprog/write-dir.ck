@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(write-dir) begin
+(write-dir) open "/"
+(write-dir) write fails
+(write-dir) pwrite fails
+(write-dir) writev fails
+(write-dir) open "sample.txt"
+(write-dir) copy_file_range fails
+(write-dir) ring_setup
+(write-dir) RING_OP_WRITE fails
+(write-dir) end
+write-dir: exit(0)
+EOF
+pass;
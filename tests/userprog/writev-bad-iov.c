@@ -0,0 +1,13 @@
+/* Passes writev() an iovec array at an unmapped address.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  writev (1, (struct iovec *) 0x20101234, 1);
+  fail ("should not have survived writev()");
+}
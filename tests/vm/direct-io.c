@@ -0,0 +1,44 @@
+/* Writes a file opened with O_DIRECT from a page-aligned buffer
+   and reads it back, which takes the direct path, then reads
+   into an unaligned buffer, which must fall back to the regular
+   path and still see the same data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 4096)
+
+static char wbuf[SIZE] __attribute__ ((aligned (4096)));
+static char rbuf[SIZE + 4096] __attribute__ ((aligned (4096)));
+
+void
+test_main (void)
+{
+  int fd;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    wbuf[i] = i % 251;
+
+  CHECK (create ("direct", SIZE), "create \"direct\"");
+  CHECK ((fd = open_flags ("direct", O_DIRECT)) > 1,
+         "open \"direct\" with O_DIRECT");
+  CHECK (write (fd, wbuf, SIZE) == SIZE,
+         "write %d bytes from a page-aligned buffer", SIZE);
+  CHECK (tell (fd) == SIZE, "file position is %d", SIZE);
+
+  seek (fd, 0);
+  CHECK (read (fd, rbuf, SIZE) == SIZE,
+         "read %d bytes into a page-aligned buffer", SIZE);
+  compare_bytes (rbuf, wbuf, SIZE, 0, "direct");
+
+  seek (fd, 0);
+  CHECK (read (fd, rbuf + 1, SIZE) == SIZE,
+         "read %d bytes into an unaligned buffer", SIZE);
+  compare_bytes (rbuf + 1, wbuf, SIZE, 0, "direct");
+
+  msg ("close \"direct\"");
+  close (fd);
+}
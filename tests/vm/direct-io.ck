@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(direct-io) begin
+(direct-io) create "direct"
+(direct-io) open "direct" with O_DIRECT
+(direct-io) write 8192 bytes from a page-aligned buffer
+(direct-io) file position is 8192
+(direct-io) read 8192 bytes into a page-aligned buffer
+(direct-io) read 8192 bytes into an unaligned buffer
+(direct-io) close "direct"
+(direct-io) end
+direct-io: exit(0)
+EOF
+pass;
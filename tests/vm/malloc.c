@@ -0,0 +1,86 @@
+/* Exercises the user-space allocator: blocks of many sizes keep
+   their contents independently, realloc() preserves data,
+   calloc() returns zeroed memory, and a multi-page block plus
+   reuse after free() both work. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 64
+#define BIG (5 * 4096 + 123)
+
+static uint8_t *blocks[BLOCK_CNT];
+
+static size_t
+block_size (int i)
+{
+  return 1 + i * 37 % 700;
+}
+
+static void
+check_block (const uint8_t *p, size_t size, int pattern)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != (uint8_t) (pattern + i))
+      fail ("block %d byte %zu is %d", pattern, i, p[i]);
+}
+
+void
+test_main (void)
+{
+  uint8_t *p, *q;
+  size_t i;
+  int b;
+
+  for (b = 0; b < BLOCK_CNT; b++)
+    {
+      blocks[b] = malloc (block_size (b));
+      if (blocks[b] == NULL)
+        fail ("malloc(%zu) failed", block_size (b));
+      for (i = 0; i < block_size (b); i++)
+        blocks[b][i] = b + i;
+    }
+  for (b = 0; b < BLOCK_CNT; b++)
+    check_block (blocks[b], block_size (b), b);
+  msg ("%d blocks allocated and intact", BLOCK_CNT);
+
+  for (b = 0; b < BLOCK_CNT; b += 2)
+    free (blocks[b]);
+  for (b = 1; b < BLOCK_CNT; b += 2)
+    check_block (blocks[b], block_size (b), b);
+  msg ("remaining blocks intact after freeing half");
+
+  p = realloc (blocks[1], 3000);
+  CHECK (p != NULL, "realloc to a larger size");
+  check_block (p, block_size (1), 1);
+  blocks[1] = p;
+
+  p = calloc (100, 40);
+  CHECK (p != NULL, "calloc");
+  for (i = 0; i < 100 * 40; i++)
+    if (p[i] != 0)
+      fail ("calloc byte %zu is %d", i, p[i]);
+  free (p);
+
+  p = malloc (BIG);
+  CHECK (p != NULL, "malloc of a multi-page block");
+  memset (p, 0x5a, BIG);
+  q = malloc (16);
+  CHECK (q != NULL && (q + 16 <= p || q >= p + BIG),
+         "small block does not overlap the big one");
+  for (i = 0; i < BIG; i++)
+    if (p[i] != 0x5a)
+      fail ("big block byte %zu is %d", i, p[i]);
+  free (q);
+  free (p);
+
+  for (b = 1; b < BLOCK_CNT; b += 2)
+    free (blocks[b]);
+  free (NULL);
+  CHECK (malloc (0) == NULL, "malloc(0) returns NULL");
+}
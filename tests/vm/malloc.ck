@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc) begin
+(malloc) 64 blocks allocated and intact
+(malloc) remaining blocks intact after freeing half
+(malloc) realloc to a larger size
+(malloc) calloc
+(malloc) malloc of a multi-page block
+(malloc) small block does not overlap the big one
+(malloc) malloc(0) returns NULL
+(malloc) end
+malloc: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Grows the heap with sbrk(), checks that the new pages read as
+   zero and hold writes, shrinks it back, checks that shrinking
+   below the start of the heap fails, and then touches a released
+   page, which must kill the process. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define GROW (3 * PAGE_SIZE)
+
+void
+test_main (void)
+{
+  uint8_t *base, *p;
+  size_t i;
+
+  base = sbrk (0);
+  p = sbrk (GROW);
+  CHECK (p == base, "sbrk returns the old break");
+  CHECK ((uint8_t *) sbrk (0) == base + GROW, "break moved up by 3 pages");
+
+  for (i = 0; i < GROW; i++)
+    if (p[i] != 0)
+      fail ("byte %zu of new heap is %d, not 0", i, p[i]);
+  for (i = 0; i < GROW; i++)
+    p[i] = i % 251;
+  for (i = 0; i < GROW; i++)
+    if (p[i] != i % 251)
+      fail ("byte %zu of heap reads %d, expected %zu", i, p[i], i % 251);
+  msg ("heap pages zero-filled and writable");
+
+  CHECK ((uint8_t *) sbrk (-GROW) == base + GROW,
+         "shrinking returns the old break");
+  CHECK ((uint8_t *) sbrk (0) == base, "break back at start");
+  CHECK (sbrk (-PAGE_SIZE) == (void *) -1,
+         "shrinking below the heap start fails");
+
+  p = (uint8_t *) (((uintptr_t) base + 2 * PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+  msg ("touch released page");
+  p[0] = 1;
+  fail ("released heap page still writable");
+}
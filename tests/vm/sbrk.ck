@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk) begin
+(sbrk) sbrk returns the old break
+(sbrk) break moved up by 3 pages
+(sbrk) heap pages zero-filled and writable
+(sbrk) shrinking returns the old break
+(sbrk) break back at start
+(sbrk) shrinking below the heap start fails
+(sbrk) touch released page
+sbrk: exit(-1)
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Shares memory with a forked child in two ways: an anonymous
+   shared page that the child inherits, and a named object that
+   the child maps again at an address of its own.  The parent must
+   see what the child wrote through both. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ANON ((int *) 0x10000000)
+#define NAMED ((int *) 0x10001000)
+#define CHILD_NAMED ((int *) 0x10002000)
+
+void
+test_main (void)
+{
+  int *anon, *named;
+  int status;
+  pid_t pid;
+
+  CHECK ((anon = shm_map (ANON, 4096, NULL)) == ANON,
+         "map an anonymous shared page");
+  CHECK ((named = shm_map (NAMED, 4096, "counter")) == NAMED,
+         "map \"counter\"");
+  *anon = 1;
+  *named = 1;
+
+  pid = fork ("shm-child");
+  if (pid == 0)
+    {
+      int *mine = shm_map (CHILD_NAMED, 4096, "counter");
+
+      *anon = 2;
+      if (mine == NULL)
+        exit (1);
+      *mine = 3;
+      exit (0);
+    }
+  status = wait (pid);
+  CHECK (status == 0, "wait for child");
+  CHECK (*anon == 2, "child's write to the anonymous page is visible");
+  CHECK (*named == 3, "child's write to \"counter\" is visible");
+
+  CHECK (shm_unlink ("counter"), "unlink \"counter\"");
+  CHECK (!shm_unlink ("counter"), "unlink \"counter\" again fails");
+  CHECK (*named == 3, "mapping outlives the name");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-fork) begin
+(shm-fork) map an anonymous shared page
+(shm-fork) map "counter"
+shm-child: exit(0)
+(shm-fork) wait for child
+(shm-fork) child's write to the anonymous page is visible
+(shm-fork) child's write to "counter" is visible
+(shm-fork) unlink "counter"
+(shm-fork) unlink "counter" again fails
+(shm-fork) mapping outlives the name
+(shm-fork) end
+shm-fork: exit(0)
+EOF
+pass;
@@ -27,6 +27,7 @@
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/vdso.h"
 #endif
 #include "tests/threads/tests.h"
 #ifdef VM
@@ -100,11 +101,15 @@ main (void) {
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	elf_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+#ifdef USERPROG
+	vdso_init ();
+#endif
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -348,6 +353,9 @@ usage (void) {
 void
 power_off (void) {
 #ifdef FILESYS
+#ifdef USERPROG
+	elf_cache_flush ();
+#endif
 	filesys_done ();
 #endif
 
@@ -363,6 +371,9 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+#ifdef USERPROG
+	syscall_print_stats ();
+#endif
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
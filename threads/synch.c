@@ -366,6 +366,79 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 		cond_signal (cond, lock);
 }
 
+/* Initializes RW, a readers-writer lock.  Any number of readers
+   may hold RW at once, or a single writer.  Waiting writers are
+   preferred over new readers, so a steady stream of readers
+   cannot starve a writer. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->lock);
+	cond_init (&rw->can_read);
+	cond_init (&rw->can_write);
+	rw->readers = 0;
+	rw->waiting_writers = 0;
+	rw->writer = false;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or
+   waits for it. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+	while (rw->writer || rw->waiting_writers > 0)
+		cond_wait (&rw->can_read, &rw->lock);
+	rw->readers++;
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->readers > 0);
+	if (--rw->readers == 0)
+		cond_signal (&rw->can_write, &rw->lock);
+	lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no reader or writer
+   holds it. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+	rw->waiting_writers++;
+	while (rw->writer || rw->readers > 0)
+		cond_wait (&rw->can_write, &rw->lock);
+	rw->waiting_writers--;
+	rw->writer = true;
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->writer);
+	rw->writer = false;
+	if (rw->waiting_writers > 0)
+		cond_signal (&rw->can_write, &rw->lock);
+	else
+		cond_broadcast (&rw->can_read, &rw->lock);
+	lock_release (&rw->lock);
+}
+
 /*추가한 부분. sema_a를 기다리는 waiters들 중 가장 큰 값과, sema_b를 기다리는 waiters들 중 가장 큰 값을 비교*/
 bool
 cmp_sema_priority(const struct list_elem *a, const struct list_elem *b,  void *aux UNUSED)
@@ -254,11 +254,6 @@ thread_create (const char *name, int priority, thread_func *function, void *aux)
 	//현재 스레드의 자식으로 추가. 가장 최근에 추가시켜줌.
 	list_push_back(&(thread_current()->child_list), &(t->child_elem));
 
-	t->fdt = palloc_get_page(PAL_ZERO);//fdt 할당
-	if(t->fdt == NULL) {
-		palloc_free_page(t);
-		return TID_ERROR;
-	}
 	/* Add to run queue. */
 	thread_unblock (t);
 	thread_preemptive(); //ready_list의 앞 부분과 비교해서 ready_list의 값이 더 클 경우 yield
@@ -560,7 +555,6 @@ init_thread (struct thread *t, const char *name, int priority) {
 	list_push_back(&all_list, &t->allelem);//mlfqs 추가한 부분. all_list
 
 	t->exit_status = 0;//exit_status 초기화
-	t->next_fd = 2;//stdin:0, stdout:1 이기 때문에
 	//load_sema, exit_sema, wait_sema 초기화
 	sema_init(&t->load_sema, 0);
 	sema_init(&t->exit_sema, 0);
@@ -11,6 +11,24 @@ static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static bool apply_fixup (struct intr_frame *);
+
+/* Instructions in userprog/usercopy-asm.S that access user memory on
+   behalf of the kernel, and where each resumes if the access
+   faults. */
+extern char usercopy_memcpy_fault[], usercopy_memcpy_fixup[];
+extern char usercopy_strncpy_fault[], usercopy_strncpy_fixup[];
+
+/* An exception fixup table entry. */
+struct fixup {
+	const void *fault_rip;      /* Instruction that may fault. */
+	const void *fixup_rip;      /* Where to resume if it does. */
+};
+
+static const struct fixup fixups[] = {
+	{ usercopy_memcpy_fault, usercopy_memcpy_fixup },
+	{ usercopy_strncpy_fault, usercopy_strncpy_fixup },
+};
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -60,6 +78,21 @@ exception_init (void) {
 	intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
 }
 
+/* If F is a fault in one of the instructions in the fixup table,
+   makes F resume at the instruction's fixup and returns true.
+   Otherwise returns false. */
+static bool
+apply_fixup (struct intr_frame *f) {
+	size_t i;
+
+	for (i = 0; i < sizeof fixups / sizeof *fixups; i++)
+		if (f->rip == (uintptr_t) fixups[i].fault_rip) {
+			f->rip = (uintptr_t) fixups[i].fixup_rip;
+			return true;
+		}
+	return false;
+}
+
 /* Prints exception statistics. */
 void
 exception_print_stats (void) {
@@ -146,12 +179,13 @@ page_fault (struct intr_frame *f) {
 	/* For project 3 and later. */
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
 		return;
-	else{
-		page_fault_cnt++;
-		exit(-1);//추가 부분
-	}
 #endif
 
+	/* A bad user address met by copy_from_user() and friends:
+	   let the copy fail instead of killing the process. */
+	if (!user && apply_fixup (f))
+		return;
+
 	/* Count page faults. */
 	page_fault_cnt++;
 	exit(-1);//추가 부분
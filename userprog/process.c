@@ -10,14 +10,18 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include <bitmap.h>
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
+#include "userprog/vdso.h"
 #ifdef VM
 #include "vm/vm.h"
 #include "userprog/syscall.h"
@@ -27,7 +31,10 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static bool load_with_args (char *file_name, struct intr_frame *if_);
 static void argument_stack(char *argv[], int argc, struct intr_frame *if_);//추가부분
+static bool fdt_grow(struct thread *t, int size);
 
 
 
@@ -194,6 +201,8 @@ __do_fork (void *aux) {
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
+	current->heap_start = parent->heap_start;
+	current->heap_end = parent->heap_end;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
@@ -205,17 +214,33 @@ __do_fork (void *aux) {
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent
 	 * */
-	 //부모의fdt를 자식에 복사
-	for (int i = 0; i < 128; i++)
+	 //부모의fdt를 자식에 복사. 같은 크기로 만들고 사용 중인 슬롯만 비트맵으로 찾아 복제한다.
+	 //0, 1은 다른 파일(파이프 등)로 바뀐 경우에만 파일이 들어 있다.
+	 //파일은 부모와 따로 움직이도록 복제하지만, 부모에서 dup2로 나눠 가진 fd들은 자식에서도 하나를 나눠 가진다.
+	if (parent->fd_map != NULL)
 	{
-		struct file *file = parent->fdt[i];
-		if (file == NULL)
-			continue;
-		if (file > 2)//stdin, sdtout, stderr 제외
-			file = file_duplicate(file);
-		current->fdt[i] = file;
+		if (!fdt_grow(current, parent->fdt_size))
+			goto error;
+		size_t fd = 0;
+		for (; (fd = bitmap_scan(parent->fd_map, fd, 1, true)) != BITMAP_ERROR; fd++)
+		{
+			if (parent->fdt[fd] == NULL)
+				continue;
+			size_t prev = 0;
+			while (prev < fd && parent->fdt[prev] != parent->fdt[fd])
+				prev++;
+			struct file *file = prev < fd ? file_share(current->fdt[prev])
+										  : file_duplicate(parent->fdt[fd]);
+			if (file == NULL)
+				goto error;
+			current->fdt[fd] = file;
+			bitmap_mark(current->fd_map, fd);
+		}
 	}
-	current->next_fd = parent->next_fd;
+	current->ring = parent->ring; // 메모리가 복사되었으므로 ring도 같은 주소에 있다.
+	// 커널 데이터 페이지는 spt에 없어서 복사되지 않으므로, 자식의 tid로 새로 매핑한다.
+	if (!vdso_map(current))
+		goto error;
 
 	// 로드가 완료될 때까지 기다리고 있던 부모 대기 해제
 	sema_up(&current->load_sema);
@@ -231,26 +256,91 @@ error:
 	// thread_exit ();
 }
 
-/* Switch the current execution context to the f_name.
- * Returns -1 on fail. 
- * 인자로 들어오는 f_name을 parsing. user stack에 매개변수를 push.
- */
+/* spawn으로 만든 자식에게 넘기는 인자. 부모는 자식이 로드를 마칠 때까지 기다리므로 부모의 스택에 둔다. */
+struct spawn_args {
+	char *cmd_line;		 // 실행할 명령줄이 담긴 페이지. 자식이 해제한다.
+	struct file **files; // 자식의 fd i에 열 파일 (NULL이면 비워 둔다). 자식이 가져간다.
+	int file_cnt;
+};
 
-int process_exec(void *f_name)
-{ 
-	char *file_name = f_name;
+/* cmd_line을 실행하는 자식 프로세스를 만든다. fork 후 exec하는 것과 같지만,
+ * 부모의 주소 공간과 fd 테이블을 복사하지 않고 자식이 빈 주소 공간에 바로 프로그램을 로드한다.
+ * cmd_line은 palloc으로 할당한 페이지이고, files는 자식의 fd i에 열 파일들이다. 둘 다 이 함수가 가져간다.
+ * 자식이 로드에 성공하면 자식의 tid를, 실패하면 TID_ERROR를 반환한다. */
+tid_t
+process_spawn (char *cmd_line, struct file **files, int file_cnt) {
+	struct spawn_args args = {cmd_line, files, file_cnt};
+
+	// 스레드 이름은 프로그램 이름이다.
+	char name[16];
+	size_t len = strcspn(cmd_line, " ");
+	strlcpy(name, cmd_line, len + 1 < sizeof name ? len + 1 : sizeof name);
+
+	tid_t pid = thread_create(name, PRI_DEFAULT, __do_spawn, &args);
+	if (pid == TID_ERROR)
+	{
+		for (int i = 0; i < file_cnt; i++)
+			file_close(files[i]);
+		palloc_free_page(cmd_line);
+		return TID_ERROR;
+	}
+
+	// fork와 같이 자식이 로드를 마칠 때까지 기다린다.
+	struct thread *child = get_child_process(pid);
+	sema_down(&child->load_sema);
+	if (child->exit_status == TID_ERROR)
+		return TID_ERROR;
+	return pid;
+}
+
+/* spawn된 자식의 스레드 함수. 넘겨받은 파일들로 fd 테이블을 채우고 프로그램을 로드한다. */
+static void
+__do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+	bool success = true;
+
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+	for (int i = 0; i < args->file_cnt; i++)
+	{
+		if (args->files[i] == NULL)
+			continue;
+		if (success && process_set_file(i, args->files[i]))
+			continue;
+		file_close(args->files[i]);
+		success = false;
+	}
+	process_init();
+
+	if (success)
+		success = load_with_args(args->cmd_line, &if_);
+	else
+		palloc_free_page(args->cmd_line);
+
+	// 로드가 끝나면 args는 더 이상 쓰지 않으므로 부모를 깨운다.
+	if (!success)
+		current->exit_status = TID_ERROR;
+	sema_up(&current->load_sema);
+	if (!success)
+		exit(TID_ERROR);
+
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* file_name을 파싱해 현재 스레드에 프로그램을 로드하고, user stack에 인자를 쌓아 if_를 채운다.
+ * file_name 페이지는 성공 여부와 관계없이 해제한다. */
+static bool
+load_with_args (char *file_name, struct intr_frame *if_) {
 	bool success;
 
-	/* We cannot use the intr_frame in the thread structure.
-	 * This is because when current thread rescheduled,
-	 * it stores the execution information to the member. */
-	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+	if_->ds = if_->es = if_->ss = SEL_UDSEG;
+	if_->cs = SEL_UCSEG;
+	if_->eflags = FLAG_IF | FLAG_MBS;
 
-	/* We first kill the current context */
-	process_cleanup();
 	char *token, *save_ptr;
     char *argv[128];
     int argc = 0;
@@ -258,27 +348,41 @@ int process_exec(void *f_name)
         argv[argc++] = token;
     }
 	/* And then load the binary */
-	lock_acquire(&filesys_lock);
-	success = load(file_name, &_if);
-	lock_release(&filesys_lock);
+	success = load(file_name, if_);
 	// 이진 파일을 디스크에서 메모리로 로드한다.
 	// 이진 파일에서 실행하려는 명령의 위치를 얻고 (if_.rip)
 	// user stack의 top 포인터를 얻는다. (if_.rsp)
-	// 위 과정을 성공하면 실행을 계속하고, 실패하면 스레드가 종료된다.
-
-	/* If load failed, quit. */
-	if (!success)
-	{
-		palloc_free_page(file_name);
-		return -1;
-	}
 
 	// 함수 내부에서 parse와 rsp의 값을 직접 변경하기 위해 주소 전달
-	argument_stack(&argv, argc, &_if);
+	if (success)
+		argument_stack(argv, argc, if_);
 
 	// hex_dump(_if.rsp, _if.rsp, USER_STACK - (uint64_t)_if.rsp, true); // user stack을 16진수로 프린트
 
 	palloc_free_page(file_name);
+	return success;
+}
+
+/* Switch the current execution context to the f_name.
+ * Returns -1 on fail. 
+ * 인자로 들어오는 f_name을 parsing. user stack에 매개변수를 push.
+ */
+
+int process_exec(void *f_name)
+{ 
+	/* We cannot use the intr_frame in the thread structure.
+	 * This is because when current thread rescheduled,
+	 * it stores the execution information to the member. */
+	struct intr_frame _if;
+
+	/* We first kill the current context */
+	process_cleanup();
+	thread_current()->ring = NULL; // 등록된 ring은 이전 주소 공간과 함께 사라진다.
+
+	/* If load failed, quit. */
+	// 위 과정을 성공하면 실행을 계속하고, 실패하면 스레드가 종료된다.
+	if (!load_with_args(f_name, &_if))
+		return -1;
 
 	/* Start switched process. */
 	do_iret(&_if);
@@ -320,11 +424,18 @@ process_wait (tid_t child_tid UNUSED) {
 void
 process_exit (void) {
 	 struct thread *curr = thread_current();
-	 //fdt의 모든 파일을 닫음.
-		for(int i = 2; i< 128; i++){
-		if(curr->fdt[i] != NULL)close(i);//파일 닫기
+	 //fdt의 모든 파일을 닫음. 사용 중인 슬롯만 비트맵으로 찾아간다.
+	 if (curr->fd_map != NULL)
+	 {
+		size_t fd = 0;
+		while ((fd = bitmap_scan(curr->fd_map, fd, 1, true)) != BITMAP_ERROR)
+			close(fd++);//파일 닫기
+		bitmap_destroy(curr->fd_map);//fdt 해제
+		curr->fd_map = NULL;
 	 }
-	 if(curr->fdt != NULL) palloc_free_page(curr->fdt);//fdt 해제. multi-oom?
+	 free(curr->fdt);
+	 curr->fdt = NULL;
+	 curr->fdt_size = 0;
 	 if(curr->running != NULL) file_close(curr->running);//현재 실행 중인 파일도 닫음.
 
 	process_cleanup ();
@@ -358,6 +469,7 @@ process_cleanup (void) {
 		 * directory before destroying the process's page
 		 * directory, or our active page directory will be one
 		 * that's been freed (and cleared). */
+		vdso_unmap (curr);
 		curr->pml4 = NULL;
 		pml4_activate (NULL);
 		pml4_destroy (pml4);
@@ -477,39 +589,85 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
- * Stores the executable's entry point into *RIP
- * and its initial stack pointer into *RSP.
- * Returns true if successful, false otherwise. */
+/* 실행 파일에서 읽어 들인 PT_LOAD 세그먼트 하나. load_segment()의 인자 그대로다. */
+struct elf_segment {
+	off_t file_page;
+	uint64_t mem_page;
+	uint32_t read_bytes;
+	uint32_t zero_bytes;
+	bool writable;
+};
+
+/* 실행 파일 하나를 파싱한 결과. */
+struct elf_layout {
+	struct inode *inode;	   // 캐시 항목이면 파싱한 실행 파일 (캐시가 열어 둔다), 빈 항목이면 NULL
+	unsigned generation;	   // 파싱할 때의 inode 쓰기 세대
+	unsigned last_used;		   // LRU로 쫓아낼 항목을 고르는 데 쓴다.
+	uint64_t entry;
+	int seg_cnt;
+	struct elf_segment *segs;
+};
+
+/* 최근에 실행한 실행 파일들의 파싱 결과.
+ * 같은 프로그램을 다시 실행하면 ELF 헤더와 program header를 다시 읽지 않고 세그먼트만 만든다.
+ * 항목은 inode를 열어 두므로 inode가 같고 그 사이 쓰기가 없었으면(세대가 같으면) 그대로 쓸 수 있다.
+ * 열어 둔 inode는 지워져도 디스크에서 해제되지 않으므로, 지워진 실행 파일의 항목은
+ * elf_cache_purge()가 닫고, 종료할 때는 elf_cache_flush()가 모든 항목을 닫는다. */
+#define ELF_CACHE_SIZE 8
+static struct elf_layout elf_cache[ELF_CACHE_SIZE];
+static struct lock elf_cache_lock;
+static unsigned elf_cache_clock;
+
+void
+elf_cache_init (void) {
+	lock_init (&elf_cache_lock);
+}
+
+/* 캐시 항목 E를 닫고 비운다. elf_cache_lock을 잡은 상태에서 부른다. */
+static void
+elf_cache_drop (struct elf_layout *e) {
+	inode_close (e->inode);
+	free (e->segs);
+	e->inode = NULL;
+	e->segs = NULL;
+	e->last_used = 0;
+}
+
+/* 지워진 실행 파일의 항목들을 닫아서, 그 파일을 실행 중인 프로세스가 없으면 바로 디스크에서 해제되게 한다.
+ * 파일을 지운 뒤에 부른다. */
+void
+elf_cache_purge (void) {
+	int i;
+
+	lock_acquire (&elf_cache_lock);
+	for (i = 0; i < ELF_CACHE_SIZE; i++)
+		if (elf_cache[i].inode != NULL && inode_is_removed (elf_cache[i].inode))
+			elf_cache_drop (&elf_cache[i]);
+	lock_release (&elf_cache_lock);
+}
+
+/* 모든 항목을 닫는다. 파일 시스템을 닫기 전에 부른다. */
+void
+elf_cache_flush (void) {
+	int i;
+
+	lock_acquire (&elf_cache_lock);
+	for (i = 0; i < ELF_CACHE_SIZE; i++)
+		if (elf_cache[i].inode != NULL)
+			elf_cache_drop (&elf_cache[i]);
+	lock_release (&elf_cache_lock);
+}
+
+/* FILE의 ELF 헤더와 program header를 읽어 *LAYOUT을 채운다.
+ * 성공하면 LAYOUT->segs는 호출자가 해제한다. */
 static bool
-load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
+elf_parse (const char *file_name, struct file *file, struct elf_layout *layout) {
 	struct ELF ehdr;
-	struct file *file = NULL;
 	off_t file_ofs;
-	bool success = false;
 	int i;
 
-	/* Allocate and activate page directory. */
-	t->pml4 = pml4_create ();//pml4테이블: 64비트 주소 공간을 512개의 64비트 엔트리로 나누어 관리
-	if (t->pml4 == NULL)
-		goto done;
-	process_activate (thread_current ());
-
-	/* Open executable file. */
-	file = filesys_open (file_name);
-	if (file == NULL) {
-		printf ("load: %s: open failed\n", file_name);
-		goto done;
-	}
-	/* 추가한 부분.
-	 * load()를 한 후 실행한 파일의 쓰기 권한을 deny_write해야 함.
-	 * rox
-	 */
-    t->running = file;
-    file_deny_write(file);
-
 	/* Read and verify executable header. */
+	file_seek (file, 0);
 	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
@@ -518,20 +676,26 @@ load (const char *file_name, struct intr_frame *if_) {
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
 			|| ehdr.e_phnum > 1024) {
 		printf ("load: %s: error loading executable\n", file_name);
-		goto done;
+		return false;
 	}
 
+	layout->entry = ehdr.e_entry;
+	layout->seg_cnt = 0;
+	layout->segs = malloc ((ehdr.e_phnum + 1) * sizeof *layout->segs);
+	if (layout->segs == NULL)
+		return false;
+
 	/* Read program headers. */
 	file_ofs = ehdr.e_phoff;
 	for (i = 0; i < ehdr.e_phnum; i++) {
 		struct Phdr phdr;
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
-			goto done;
+			goto fail;
 		file_seek (file, file_ofs);
 
 		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
+			goto fail;
 		file_ofs += sizeof phdr;
 		switch (phdr.p_type) {
 			case PT_NULL:
@@ -544,42 +708,164 @@ load (const char *file_name, struct intr_frame *if_) {
 			case PT_DYNAMIC:
 			case PT_INTERP:
 			case PT_SHLIB:
-				goto done;
+				goto fail;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+					struct elf_segment *seg = &layout->segs[layout->seg_cnt++];
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
+					seg->writable = (phdr.p_flags & PF_W) != 0;
+					seg->file_page = phdr.p_offset & ~PGMASK;
+					seg->mem_page = phdr.p_vaddr & ~PGMASK;
 					if (phdr.p_filesz > 0) {
 						/* Normal segment.
 						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
+						seg->read_bytes = page_offset + phdr.p_filesz;
+						seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+								- seg->read_bytes);
 					} else {
 						/* Entirely zero.
 						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+						seg->read_bytes = 0;
+						seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
 				}
 				else
-					goto done;
+					goto fail;
 				break;
 		}
 	}
+	return true;
+
+fail:
+	free (layout->segs);
+	layout->segs = NULL;
+	return false;
+}
+
+/* 캐시에서 LAYOUT의 내용을 새로 할당한 세그먼트 배열과 함께 DST에 복사한다. */
+static bool
+elf_layout_copy (struct elf_layout *dst, const struct elf_layout *layout) {
+	struct elf_segment *segs = malloc ((layout->seg_cnt + 1) * sizeof *segs);
+	if (segs == NULL)
+		return false;
+	memcpy (segs, layout->segs, layout->seg_cnt * sizeof *segs);
+	*dst = *layout;
+	dst->segs = segs;
+	return true;
+}
+
+/* 실행 파일 FILE의 세그먼트 배치를 *LAYOUT에 채운다. FILE은 이미 쓰기가 금지되어 있어야 한다.
+ * 캐시에 같은 inode, 같은 세대의 항목이 있으면 그것을 복사하고, 없으면 파싱한 뒤
+ * 가장 오래 쓰이지 않은 항목 자리에 넣는다. LAYOUT->segs는 호출자가 해제한다. */
+static bool
+elf_layout_get (const char *file_name, struct file *file, struct elf_layout *layout) {
+	struct inode *inode = file_get_inode (file);
+	unsigned generation = inode_get_generation (inode);
+	struct elf_layout *victim;
+	bool hit = false, ok = false;
+	int i;
+
+	lock_acquire (&elf_cache_lock);
+	for (i = 0; i < ELF_CACHE_SIZE; i++) {
+		struct elf_layout *e = &elf_cache[i];
+		if (e->inode == inode && e->generation == generation) {
+			e->last_used = ++elf_cache_clock;
+			hit = true;
+			ok = elf_layout_copy (layout, e);
+			break;
+		}
+	}
+	lock_release (&elf_cache_lock);
+	if (hit)
+		return ok;
+
+	if (!elf_parse (file_name, file, layout))
+		return false;
+
+	/* 캐시에 넣는다. 캐시에 넣지 못해도 load는 계속할 수 있다. */
+	struct elf_layout entry;
+	if (!elf_layout_copy (&entry, layout))
+		return true;
+	entry.inode = inode_reopen (inode);
+	entry.generation = generation;
+
+	lock_acquire (&elf_cache_lock);
+	victim = &elf_cache[0];
+	for (i = 1; i < ELF_CACHE_SIZE; i++)
+		if (elf_cache[i].last_used < victim->last_used)
+			victim = &elf_cache[i];
+	if (victim->inode != NULL)
+		elf_cache_drop (victim);
+	entry.last_used = ++elf_cache_clock;
+	*victim = entry;
+	lock_release (&elf_cache_lock);
+	return true;
+}
+
+/* Loads an ELF executable from FILE_NAME into the current thread.
+ * Stores the executable's entry point into *RIP
+ * and its initial stack pointer into *RSP.
+ * Returns true if successful, false otherwise. */
+static bool
+load (const char *file_name, struct intr_frame *if_) {
+	struct thread *t = thread_current ();
+	struct elf_layout layout = { .segs = NULL };
+	struct file *file = NULL;
+	bool success = false;
+	int i;
+
+	/* Allocate and activate page directory. */
+	t->pml4 = pml4_create ();//pml4테이블: 64비트 주소 공간을 512개의 64비트 엔트리로 나누어 관리
+	if (t->pml4 == NULL)
+		goto done;
+	process_activate (thread_current ());
+
+	/* Open executable file. */
+	file = filesys_open (file_name);
+	if (file == NULL) {
+		printf ("load: %s: open failed\n", file_name);
+		goto done;
+	}
+	/* 추가한 부분.
+	 * load()를 한 후 실행한 파일의 쓰기 권한을 deny_write해야 함.
+	 * rox
+	 */
+    t->running = file;
+    file_deny_write(file);
+
+	/* Read the segment layout, from the cache if this executable
+	 * was loaded before. */
+	if (!elf_layout_get (file_name, file, &layout))
+		goto done;
+	for (i = 0; i < layout.seg_cnt; i++) {
+		struct elf_segment *seg = &layout.segs[i];
+		if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+					seg->read_bytes, seg->zero_bytes, seg->writable))
+			goto done;
+	}
+
+#ifdef VM
+	/* The heap starts at the end of the highest segment. */
+	t->heap_start = NULL;
+	for (i = 0; i < layout.seg_cnt; i++) {
+		struct elf_segment *seg = &layout.segs[i];
+		void *seg_end = (void *) (seg->mem_page + seg->read_bytes + seg->zero_bytes);
+		if (seg_end > t->heap_start)
+			t->heap_start = seg_end;
+	}
+	t->heap_end = t->heap_start;
+#endif
 
 	/* Set up stack. */
 	if (!setup_stack (if_))
 		goto done;
 
+	/* Map the kernel data page. */
+	if (!vdso_map (t))
+		goto done;
+
 	/* Start address. */
-	if_->rip = ehdr.e_entry;
+	if_->rip = layout.entry;
 
 	/* TODO: Your code goes here.
 	 * TODO: Implement argument passing (see project2/argument_passing.html). */
@@ -588,6 +874,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 done:
 	/* We arrive here whether the load is successful or not. */
+	free (layout.segs);
 	//여기에서 file_close()를 해주면 file이 닫히면서 lock이 풀린다.
 	// file_close (file);
 	return success;
@@ -763,6 +1050,51 @@ lazy_load_segment (struct page *page, void *aux) {
 	return true;
 }
 
+/* load_segment가 세그먼트마다 한 번에 할당하는 aux 묶음. 페이지마다 pages[i]를 aux로 받는다.
+ * fork한 자식의 uninit 페이지도 같은 aux를 가리키므로, 묶음을 aux로 가진 uninit 페이지 수를 세어
+ * 마지막 페이지가 로드되거나 파괴될 때 해제한다. */
+struct segment_aux
+{
+	int ref_cnt;
+	struct segment_page
+	{
+		struct lazy_load_arg arg; // 맨 앞에 두어 lazy_load_segment에 그대로 넘긴다.
+		struct segment_aux *seg;
+	} pages[];
+};
+
+// 세그먼트 페이지의 initializer. 읽어 들인 뒤에는 aux가 필요 없으므로 참조를 놓는다.
+static bool
+lazy_load_segment_page (struct page *page, void *aux) {
+	bool success = lazy_load_segment (page, aux);
+	segment_aux_release (lazy_load_segment_page, aux);
+	return success;
+}
+
+/* uninit 페이지를 만들거나 fork로 복사할 때 부른다. init이 세그먼트 페이지의 것이면 aux의 묶음에 참조를 더한다. */
+void
+segment_aux_hold (bool (*init) (struct page *, void *), void *aux) {
+	if (init != lazy_load_segment_page)
+		return;
+	struct segment_aux *seg = ((struct segment_page *) aux)->seg;
+	enum intr_level old_level = intr_disable ();
+	seg->ref_cnt++;
+	intr_set_level (old_level);
+}
+
+/* uninit 페이지가 로드되거나 파괴될 때 부른다. 세그먼트 페이지면 참조를 놓고, 마지막이면 묶음을 해제한다. */
+void
+segment_aux_release (bool (*init) (struct page *, void *), void *aux) {
+	if (init != lazy_load_segment_page)
+		return;
+	struct segment_aux *seg = ((struct segment_page *) aux)->seg;
+	enum intr_level old_level = intr_disable ();
+	bool last = --seg->ref_cnt == 0;
+	intr_set_level (old_level);
+	if (last)
+		free (seg);
+}
+
 /* Loads a segment starting at offset OFS in FILE at address
  * UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
  * memory are initialized, as follows:
@@ -783,6 +1115,17 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT(pg_ofs(upage) == 0);						 // upage가 페이지 정렬되어 있는지 확인
 	ASSERT(ofs % PGSIZE == 0)						 // ofs가 페이지 정렬되어 있는지 확인;
 
+	// 페이지마다 malloc하지 않도록 세그먼트의 aux를 한 번에 할당한다. 참조는 페이지를 만들 때마다 센다.
+	size_t page_cnt = DIV_ROUND_UP(read_bytes + zero_bytes, PGSIZE);
+	if (page_cnt == 0)
+		return true;
+	struct segment_aux *seg = malloc(sizeof *seg + page_cnt * sizeof *seg->pages);
+	if (seg == NULL)
+		return false;
+	seg->ref_cnt = 1; // 페이지를 다 만들 때까지 이 함수가 잡고 있는 참조
+	struct segment_page *sp = seg->pages;
+	bool success = true;
+
 	while (read_bytes > 0 || zero_bytes > 0) // read_bytes와 zero_bytes가 0보다 큰 동안 루프를 실행
 	{
 		/* Do calculate how to fill this page.
@@ -795,15 +1138,21 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
 		// vm_alloc_page_with_initializer에 제공할 aux 인수로 필요한 보조 값들을 설정해야 합니다.
 		// loading을 위해 필요한 정보를 포함하는 구조체를 만들어야 합니다.
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		sp->seg = seg;
+		struct lazy_load_arg *lazy_load_arg = &sp++->arg;
 		lazy_load_arg->file = file;					 // 내용이 담긴 파일 객체
 		lazy_load_arg->ofs = ofs;					 // 이 페이지에서 읽기 시작할 위치
 		lazy_load_arg->read_bytes = page_read_bytes; // 이 페이지에서 읽어야 하는 바이트 수
 		lazy_load_arg->zero_bytes = page_zero_bytes; // 이 페이지에서 read_bytes만큼 읽고 공간이 남아 0으로 채워야 하는 바이트 수
 		// vm_alloc_page_with_initializer를 호출하여 대기 중인 객체를 생성합니다.
+		segment_aux_hold(lazy_load_segment_page, lazy_load_arg);
 		if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-											writable, lazy_load_segment, lazy_load_arg))
-			return false;
+											writable, lazy_load_segment_page, lazy_load_arg))
+		{
+			segment_aux_release(lazy_load_segment_page, lazy_load_arg);
+			success = false;
+			break;
+		}
 
 		/* Advance. */
 		// 다음 반복을 위하여 읽어들인 만큼 값을 갱신합니다.
@@ -812,7 +1161,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		upage += PGSIZE;
 		ofs += page_read_bytes;
 	}
-	return true;
+	// 만든 페이지들이 참조를 가지므로 이 함수의 참조를 놓는다. 실패하면 이미 만든 페이지는 spt와 함께 파괴된다.
+	segment_aux_release(lazy_load_segment_page, seg->pages);
+	return success;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -846,25 +1197,62 @@ setup_stack (struct intr_frame *if_) {
 }
 #endif /* VM */
 
+/**
+ * t의 fdt를 size 슬롯으로 늘린다. 아직 없으면 새로 만들고 0, 1(콘솔)을 사용 중으로 표시한다.
+ * 비트맵은 크기를 바꿀 수 없으므로 새로 만들어 사용 중 표시를 옮긴다.
+ * 늘린 만큼의 새 슬롯은 비어 있다. 메모리가 부족하면 false를 리턴하고 t의 fdt는 그대로 쓸 수 있다.
+*/
+static bool fdt_grow(struct thread *t, int size)
+{
+	ASSERT(size > t->fdt_size);
+
+	struct file **fdt = realloc(t->fdt, size * sizeof *fdt);
+	if (fdt == NULL)
+		return false;
+	t->fdt = fdt;
+
+	struct bitmap *map = bitmap_create(size);
+	if (map == NULL)
+		return false;
+	memset(fdt + t->fdt_size, 0, (size - t->fdt_size) * sizeof *fdt);
+	if (t->fd_map != NULL)
+	{
+		for (int fd = 0; fd < t->fdt_size; fd++)
+			bitmap_set(map, fd, bitmap_test(t->fd_map, fd));
+		bitmap_destroy(t->fd_map);
+	}
+	else
+		bitmap_set_multiple(map, 0, 2, true);
+	t->fd_map = map;
+	t->fdt_size = size;
+	return true;
+}
+
 /**
  * 현재 스레드의 fdt에 현재 파일을 추가한다.
- * 스레드에 저장되어 있는 next_fd부터 탐색을 시작해 LIMIT 전까지 탐색해서 빈 자리에 할당한다.
+ * 비어 있는 가장 작은 fd를 비트맵에서 찾아 할당하고, 빈 자리가 없으면 fdt를 두 배로 늘린다.
+ * fdt는 처음 파일을 열 때 만들어지므로 파일을 열지 않는 스레드는 메모리를 쓰지 않는다.
  * 할당을 성공했으면 fd를, 실패했으면 -1을 리턴한다.
 */
 int process_add_file(struct file *f)
 {
 	struct thread *curr = thread_current();
-	struct file **fdt = curr->fdt;
 
-	// limit을 넘지 않는 범위 안에서 빈 자리 탐색
-	while (curr->next_fd < 128 && fdt[curr->next_fd]){
-		curr->next_fd++;
-	}
-	if (curr->next_fd >= 128)
+	if (curr->fd_map == NULL && !fdt_grow(curr, FDT_INITIAL_SIZE))
 		return -1;
-	fdt[curr->next_fd] = f;
 
-	return curr->next_fd;
+	size_t fd = bitmap_scan_and_flip(curr->fd_map, 0, 1, false);
+	if (fd == BITMAP_ERROR)
+	{
+		// 꽉 찼으면 limit을 넘지 않는 범위 안에서 늘린다. 새 fd는 늘어난 부분의 첫 슬롯이다.
+		int size = curr->fdt_size * 2 < FDT_COUNT_LIMIT ? curr->fdt_size * 2 : FDT_COUNT_LIMIT;
+		fd = curr->fdt_size;
+		if (size <= curr->fdt_size || !fdt_grow(curr, size))
+			return -1;
+		bitmap_mark(curr->fd_map, fd);
+	}
+	curr->fdt[fd] = f;
+	return fd;
 }
 
 //스레드가 가진 파일 디스크립터 테이블 fdt에서 fd에 해당하는 파일을 리턴하는 함수
@@ -873,8 +1261,8 @@ struct file *process_get_file(int fd)
 	struct thread *curr = thread_current();
 	struct file **fdt = curr->fdt;
 	/* 파일 디스크립터에 해당하는 파일 객체를 리턴 */
-	/* 없을 시 NULL 리턴 */
-	if (fd < 2 || fd >= 128)
+	/* 없을 시 NULL 리턴. 0, 1은 dup2로 바꾼 경우에만 파일이 있고, 아니면 콘솔이다. */
+	if (fd < 0 || fd >= curr->fdt_size)
 		return NULL;
 	return fdt[fd];
 }
@@ -884,9 +1272,38 @@ void process_close_file(int fd)
 {
 	struct thread *curr = thread_current();
 	struct file **fdt = curr->fdt;
-	if (fd < 2 || fd >= 128)
-		return NULL;
+	if (fd < 0 || fd >= curr->fdt_size)
+		return;
 	fdt[fd] = NULL;
+	if (fd >= 2) // 0, 1은 콘솔 자리로 남겨 둔다.
+		bitmap_reset(curr->fd_map, fd);
+}
+
+/**
+ * 현재 스레드의 fdt에서 fd 자리에 파일 f를 넣는다 (dup2). 그 자리는 비어 있어야 한다.
+ * fd가 fdt 밖이면 fd가 들어갈 때까지 fdt를 늘린다.
+ * 성공하면 true, fd가 범위를 벗어났거나 메모리가 부족하면 false를 리턴한다.
+*/
+bool process_set_file(int fd, struct file *f)
+{
+	struct thread *curr = thread_current();
+
+	if (fd < 0 || fd >= FDT_COUNT_LIMIT)
+		return false;
+	if (fd >= curr->fdt_size)
+	{
+		int size = curr->fdt_size > 0 ? curr->fdt_size : FDT_INITIAL_SIZE;
+		while (size <= fd)
+			size *= 2;
+		if (size > FDT_COUNT_LIMIT)
+			size = FDT_COUNT_LIMIT;
+		if (!fdt_grow(curr, size))
+			return false;
+	}
+	ASSERT(curr->fdt[fd] == NULL);
+	curr->fdt[fd] = f;
+	bitmap_mark(curr->fd_map, fd);
+	return true;
 }
 
 // 자식 리스트에서 원하는 프로세스를 검색하는 함수
@@ -14,37 +14,62 @@
 #include "devices/input.h"
 #include "lib/kernel/stdio.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
+#include "devices/disk.h"
 #include "vm/vm.h"
+#include <fcntl.h>
+#include <round.h>
+#include <string.h>
+#include <uio.h>
+#include <dirent.h>
+#include <ring.h>
+#include <vdso.h>
+#include <sysstat.h>
+#include <inttypes.h>
+#include "filesys/directory.h"
+#include "filesys/inode.h"
+#include "userprog/usercopy.h"
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
-// Project 3 - Anonymous Page
-// #ifndef VM
-	void check_address(void *addr);
-// #else
-/** #Project 3: Anonymous Page */
-// 	struct page *check_address(void *addr);
-// #endif
+// 유저가 넘긴 파일 이름을 복사해 올 커널 버퍼의 크기
+#define NAME_BUF_SIZE 128
 
 void halt(void);
 void exit(int status);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
-int open(const char *file_name);
+int open(const char *file_name, int flags);
 int filesize(int fd);
 int read(int fd, void *buffer, unsigned size);
 int write(int fd, const void *buffer, unsigned size);
+int pread(int fd, void *buffer, unsigned size, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range(int fd_in, int fd_out, unsigned size);
+bool readdir(int fd, char *name);
+int getdents(int fd, struct dirent *ents, unsigned size);
+int ring_setup(struct ring *ring);
+int pipe(int *fds);
+void *shm_map_syscall(void *addr, size_t length, const char *name);
+bool shm_unlink_syscall(const char *name);
+int dup2(int oldfd, int newfd);
+int ring_enter(unsigned to_submit);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
 tid_t fork(const char *thread_name, struct intr_frame *f);
 int exec(const char *cmd_line);
+tid_t spawn(const char *cmd_line, const int *fds, int fd_cnt);
 int wait(int pid);
+int syscall_stats(struct syscall_stat *buf, unsigned cnt);
 
 //Project3. mmap, munmap 구현
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+void *sbrk(intptr_t increment);
 
 
 /* System call.
@@ -77,78 +102,143 @@ syscall_init (void) {
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
 	/**
-	 * filesys_lock? 파일 시스템에 대한 동시 접근을 제어하기 위해 사용.(race condition 방지)
+	 * 전역 filesys_lock은 없다. 동시 접근은 파일 시스템 내부에서 제어한다.
+	 * inode마다 reader/writer lock, 디렉터리마다 lock, free-map/FAT 할당 lock.
+	 * 서로 다른 파일을 다루는 프로세스들의 디스크 I/O가 겹쳐서 진행될 수 있다.
 	*/
-	lock_init(&filesys_lock);//file system lock 초기화
 }
 
+/* 시스템 콜 처리 함수의 공통 형태. 레지스터 순서대로 꺼낸 인자 배열과 intr_frame을 받아 rax에 넣을 값을 돌려준다.
+ * 실제 함수마다 하나씩 있는 아래의 thunk가 인자를 제 타입으로 바꿔 부르고, 반환값도 제 타입에서 넓힌다. */
+typedef uint64_t syscall_func(const uint64_t *a, struct intr_frame *f);
+
+static uint64_t sys_halt(const uint64_t *a UNUSED, struct intr_frame *f) { halt(); return f->R.rax; }
+static uint64_t sys_exit(const uint64_t *a, struct intr_frame *f) { exit((int)a[0]); return f->R.rax; }
+static uint64_t sys_fork(const uint64_t *a, struct intr_frame *f) { return fork((const char *)a[0], f); }
+static uint64_t sys_exec(const uint64_t *a, struct intr_frame *f UNUSED) { return exec((const char *)a[0]); }
+static uint64_t sys_wait(const uint64_t *a, struct intr_frame *f UNUSED) { return wait((int)a[0]); }
+static uint64_t sys_create(const uint64_t *a, struct intr_frame *f UNUSED) { return create((const char *)a[0], (unsigned)a[1]); }
+static uint64_t sys_remove(const uint64_t *a, struct intr_frame *f UNUSED) { return remove((const char *)a[0]); }
+static uint64_t sys_open(const uint64_t *a, struct intr_frame *f UNUSED) { return open((const char *)a[0], (int)a[1]); }
+static uint64_t sys_filesize(const uint64_t *a, struct intr_frame *f UNUSED) { return filesize((int)a[0]); }
+static uint64_t sys_read(const uint64_t *a, struct intr_frame *f UNUSED) { return read((int)a[0], (void *)a[1], (unsigned)a[2]); }
+static uint64_t sys_write(const uint64_t *a, struct intr_frame *f UNUSED) { return write((int)a[0], (const void *)a[1], (unsigned)a[2]); }
+static uint64_t sys_seek(const uint64_t *a, struct intr_frame *f) { seek((int)a[0], (unsigned)a[1]); return f->R.rax; }
+static uint64_t sys_tell(const uint64_t *a, struct intr_frame *f UNUSED) { return tell((int)a[0]); }
+static uint64_t sys_close(const uint64_t *a, struct intr_frame *f) { close((int)a[0]); return f->R.rax; }
+static uint64_t sys_mmap(const uint64_t *a, struct intr_frame *f UNUSED) { return (uint64_t)mmap((void *)a[0], (size_t)a[1], (int)a[2], (int)a[3], (off_t)a[4]); }
+static uint64_t sys_munmap(const uint64_t *a, struct intr_frame *f) { munmap((void *)a[0]); return f->R.rax; }
+static uint64_t sys_readdir(const uint64_t *a, struct intr_frame *f UNUSED) { return readdir((int)a[0], (char *)a[1]); }
+static uint64_t sys_dup2(const uint64_t *a, struct intr_frame *f UNUSED) { return dup2((int)a[0], (int)a[1]); }
+static uint64_t sys_pread(const uint64_t *a, struct intr_frame *f UNUSED) { return pread((int)a[0], (void *)a[1], (unsigned)a[2], (off_t)a[3]); }
+static uint64_t sys_pwrite(const uint64_t *a, struct intr_frame *f UNUSED) { return pwrite((int)a[0], (const void *)a[1], (unsigned)a[2], (off_t)a[3]); }
+static uint64_t sys_readv(const uint64_t *a, struct intr_frame *f UNUSED) { return readv((int)a[0], (const struct iovec *)a[1], (int)a[2]); }
+static uint64_t sys_writev(const uint64_t *a, struct intr_frame *f UNUSED) { return writev((int)a[0], (const struct iovec *)a[1], (int)a[2]); }
+static uint64_t sys_copy_file_range(const uint64_t *a, struct intr_frame *f UNUSED) { return copy_file_range((int)a[0], (int)a[1], (unsigned)a[2]); }
+static uint64_t sys_getdents(const uint64_t *a, struct intr_frame *f UNUSED) { return getdents((int)a[0], (struct dirent *)a[1], (unsigned)a[2]); }
+static uint64_t sys_ring_setup(const uint64_t *a, struct intr_frame *f UNUSED) { return ring_setup((struct ring *)a[0]); }
+static uint64_t sys_ring_enter(const uint64_t *a, struct intr_frame *f UNUSED) { return ring_enter((unsigned)a[0]); }
+static uint64_t sys_pipe(const uint64_t *a, struct intr_frame *f UNUSED) { return pipe((int *)a[0]); }
+static uint64_t sys_shm_map(const uint64_t *a, struct intr_frame *f UNUSED) { return (uint64_t)shm_map_syscall((void *)a[0], (size_t)a[1], (const char *)a[2]); }
+static uint64_t sys_shm_unlink(const uint64_t *a, struct intr_frame *f UNUSED) { return shm_unlink_syscall((const char *)a[0]); }
+static uint64_t sys_spawn(const uint64_t *a, struct intr_frame *f UNUSED) { return spawn((const char *)a[0], (const int *)a[1], (int)a[2]); }
+static uint64_t sys_syscall_stats(const uint64_t *a, struct intr_frame *f UNUSED) { return syscall_stats((struct syscall_stat *)a[0], (unsigned)a[1]); }
+static uint64_t sys_sbrk(const uint64_t *a, struct intr_frame *f UNUSED) { return (uint64_t)sbrk((intptr_t)a[0]); }
+
+struct syscall_desc
+{
+	syscall_func *func;
+	int argc; // 인자 수. 이만큼의 레지스터만 인자 배열로 옮기고, 나머지 자리는 0이다.
+	const char *name;
+};
+
+#define SYSCALL(NR, FUNC, ARGC) \
+	[NR] = {FUNC, ARGC, #NR + 4}
+
+// 시스템 콜 번호로 찾는 처리 함수 표. 비어 있는 번호는 구현되지 않은 시스템 콜이다.
+static const struct syscall_desc syscall_table[SYS_CNT] = {
+	SYSCALL(SYS_HALT, sys_halt, 0),
+	SYSCALL(SYS_EXIT, sys_exit, 1),
+	SYSCALL(SYS_FORK, sys_fork, 1),
+	SYSCALL(SYS_EXEC, sys_exec, 1),
+	SYSCALL(SYS_WAIT, sys_wait, 1),
+	SYSCALL(SYS_CREATE, sys_create, 2),
+	SYSCALL(SYS_REMOVE, sys_remove, 1),
+	SYSCALL(SYS_OPEN, sys_open, 2),
+	SYSCALL(SYS_FILESIZE, sys_filesize, 1),
+	SYSCALL(SYS_READ, sys_read, 3),
+	SYSCALL(SYS_WRITE, sys_write, 3),
+	SYSCALL(SYS_SEEK, sys_seek, 2),
+	SYSCALL(SYS_TELL, sys_tell, 1),
+	SYSCALL(SYS_CLOSE, sys_close, 1),
+	SYSCALL(SYS_MMAP, sys_mmap, 5),
+	SYSCALL(SYS_MUNMAP, sys_munmap, 1),
+	SYSCALL(SYS_READDIR, sys_readdir, 2),
+	SYSCALL(SYS_DUP2, sys_dup2, 2),
+	SYSCALL(SYS_PREAD, sys_pread, 4),
+	SYSCALL(SYS_PWRITE, sys_pwrite, 4),
+	SYSCALL(SYS_READV, sys_readv, 3),
+	SYSCALL(SYS_WRITEV, sys_writev, 3),
+	SYSCALL(SYS_COPY_FILE_RANGE, sys_copy_file_range, 3),
+	SYSCALL(SYS_GETDENTS, sys_getdents, 3),
+	SYSCALL(SYS_RING_SETUP, sys_ring_setup, 1),
+	SYSCALL(SYS_RING_ENTER, sys_ring_enter, 1),
+	SYSCALL(SYS_PIPE, sys_pipe, 1),
+	SYSCALL(SYS_SHM_MAP, sys_shm_map, 3),
+	SYSCALL(SYS_SHM_UNLINK, sys_shm_unlink, 1),
+	SYSCALL(SYS_SPAWN, sys_spawn, 3),
+	SYSCALL(SYS_SYSCALL_STATS, sys_syscall_stats, 2),
+	SYSCALL(SYS_SBRK, sys_sbrk, 1),
+};
+
+// 시스템 콜 번호별 호출 횟수와 처리에 걸린 TSC cycle. 갱신할 때는 인터럽트를 끈다.
+static struct syscall_stat stats[SYS_CNT];
+
 /* The main system call interface 
 * rsp: stack pointer, rdi: 1st arugment, rsi: 2nd argument, rdx: 3rd argument
 */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
-	//interrupt frame pointer의 stack pointer를 가져옴.
-	int syscall_num = f->R.rax; //syscall 넘버
+	uint64_t syscall_num = f->R.rax; //syscall 넘버
 	#ifdef VM
 		thread_current()->rsp = f->rsp;
-
 	#endif
-		switch (syscall_num)
-		{
-		case SYS_HALT:
-			halt();
-			break;
-		case SYS_EXIT:
-			exit(f->R.rdi);
-			break;
-		case SYS_FORK:
-			f->R.rax = fork(f->R.rdi, f);
-			break;
-		case SYS_EXEC:
-			f->R.rax = exec(f->R.rdi);
-			break;
-		case SYS_WAIT:
-			f->R.rax = wait(f->R.rdi);
-			break;
-		case SYS_CREATE:
-			f->R.rax = create(f->R.rdi, f->R.rsi);
-			break;
-		case SYS_REMOVE:
-			f->R.rax = remove(f->R.rdi);
-			break;
-		case SYS_OPEN:
-			f->R.rax = open(f->R.rdi);
-			break;
-		case SYS_FILESIZE:
-			f->R.rax = filesize(f->R.rdi);
-			break;
-		case SYS_READ:
-			f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
-			break;
-		case SYS_WRITE:
-			f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
-			break;
-		case SYS_SEEK:
-			seek(f->R.rdi, f->R.rsi);
-			break;
-		case SYS_TELL:
-			f->R.rax = tell(f->R.rdi);
-			break;
-		case SYS_CLOSE:
-			close(f->R.rdi);
-			break;
-		case SYS_MMAP:
-			f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
-			break;
-		case SYS_MUNMAP:
-			munmap(f->R.rdi);
-			break;
-		// default:
-		// 	exit(-1);//추가
-		// 	break;
-		}
-		// thread_exit (); ㅏㅏㅏㅏㅏ,,,,미친
+	if (syscall_num >= SYS_CNT || syscall_table[syscall_num].func == NULL)
+		exit(-1); // 없거나 구현되지 않은 시스템 콜
+
+	const struct syscall_desc *desc = &syscall_table[syscall_num];
+	const uint64_t regs[6] = {f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8, f->R.r9};
+	uint64_t args[6] = {0};
+	for (int i = 0; i < desc->argc; i++)
+		args[i] = regs[i];
+
+	// exit, exec처럼 돌아오지 않는 호출도 있으므로 횟수는 부르기 전에 센다.
+	struct syscall_stat *stat = &stats[syscall_num];
+	enum intr_level old_level = intr_disable();
+	stat->count++;
+	intr_set_level(old_level);
+
+	uint64_t start = rdtsc();
+	uint64_t result = desc->func(args, f);
+	uint64_t cycles = rdtsc() - start;
+
+	old_level = intr_disable();
+	stat->cycles += cycles;
+	if (cycles > stat->max_cycles)
+		stat->max_cycles = cycles;
+	intr_set_level(old_level);
+
+	f->R.rax = result;
+}
+
+/* 종료할 때 한 번이라도 불린 시스템 콜의 호출 횟수와 처리 시간을 출력한다. */
+void
+syscall_print_stats(void)
+{
+	for (int nr = 0; nr < SYS_CNT; nr++)
+		if (stats[nr].count > 0)
+			printf("Syscall %s: %"PRIu64" calls, %"PRIu64" cycles, max %"PRIu64"\n",
+				   syscall_table[nr].name, stats[nr].count, stats[nr].cycles, stats[nr].max_cycles);
 }
 
 /*
@@ -169,49 +259,70 @@ exit(int status){
 	thread_exit();
 }
 
+/* 유저 메모리와 커널 메모리 사이의 복사는 모두 usercopy.c의 함수로 한다.
+ * 잘못된 유저 주소에서 난 page fault는 exception.c의 fixup 테이블을 통해 복사 실패로 돌아오고,
+ * 아래 함수들은 그때 프로세스를 종료한다. 주소를 미리 한 바이트씩 검사할 필요가 없다. */
+
+// 유저 주소 usrc에서 size 바이트를 dst로 읽어 온다. 잘못된 주소면 프로세스를 종료한다.
+static void
+get_user(void *dst, const void *usrc, size_t size)
+{
+	if (!copy_from_user(dst, usrc, size))
+		exit(-1);
+}
+
+// src의 size 바이트를 유저 주소 udst에 쓴다. 잘못된 주소면 프로세스를 종료한다.
+static void
+put_user(void *udst, const void *src, size_t size)
+{
+	if (!copy_to_user(udst, src, size))
+		exit(-1);
+}
+
+// 유저 문자열 ustr을 크기 size의 커널 버퍼 dst로 복사한다.
+// 잘못된 주소면 프로세스를 종료하고, 버퍼에 다 들어가지 않으면 false를 반환한다.
+static bool
+get_user_string(char *dst, const char *ustr, size_t size)
+{
+	int len = strncpy_from_user(dst, ustr, size);
+	if (len < 0)
+		exit(-1);
+	return (size_t)len < size;
+}
+
 // 파일을 생성하는 syscall. file: 생성할 파일. initial_size: 생성할 파일의 크기
 bool
 create(const char *file, unsigned initial_size){
-	lock_acquire(&filesys_lock); // 추가한 부분
-	check_address(file);
-	// critical section: filesys_create(file, initial_size)
-	bool succ = filesys_create(file, initial_size); 
-	// critical section 전에 lock을 획득, 후에 해제함으로써 mutual exclusion 방지
-	lock_release(&filesys_lock); 
-	return succ;
-	// return filesys_create(file, initial_size);
+	char name[NAME_BUF_SIZE];
+	if (!get_user_string(name, file, sizeof name))
+		return false;
+	return filesys_create(name, initial_size);
 }
 
 //file 이름에 해당하는 파일 지우기
 bool
 remove(const char* file){
-	check_address(file);
-	if(file == NULL) exit(-1);
-	return filesys_remove(file);
-}
-
-// # ifndef VM
-void
-check_address(void *addr){
-	if(addr == NULL)exit(-1);
-	if(!is_user_vaddr(addr))exit(-1);
-	//pml4테이블을 이용해 가상주소를 찾을 때 없을 경우 exit
-	// if(pml4_get_page(thread_current()->pml4, addr) == NULL)exit(-1);
+	char name[NAME_BUF_SIZE];
+	if (!get_user_string(name, file, sizeof name))
+		return false;
+	if (!filesys_remove(name))
+		return false;
+	elf_cache_purge(); // 캐시가 열어 둔 실행 파일이었으면 닫아서 디스크에서 해제되게 한다.
+	return true;
 }
 
-int open(const char *file_name)
+int open(const char *file_name, int flags)
 {
-	check_address(file_name);
-	lock_acquire(&filesys_lock);
-	struct file *file = filesys_open(file_name); //critical section
+	char name[NAME_BUF_SIZE];
+	if (!get_user_string(name, file_name, sizeof name))
+		return -1;
+	struct file *file = filesys_open(name);
 	if (file == NULL)
-	{
-		lock_release(&filesys_lock);
 		return -1;
-	}
+	// O_DIRECT: 조건을 만족하는 read/write는 bounce buffer 없이 유저 frame과 디스크가 직접 주고받는다.
+	file_set_direct(file, (flags & O_DIRECT) != 0);
 	int fd = process_add_file(file);
 	if (fd == -1) file_close(file);
-	lock_release(&filesys_lock);
 	return fd;
 }
 
@@ -236,6 +347,61 @@ unsigned tell(int fd)
 	return file_tell(file);
 }
 
+// 직접 I/O가 한 번에 고정하는 유저 페이지 수의 상한. 큰 요청도 user pool을 다 고정하지 않도록 나눠서 처리한다.
+#define DIRECT_MAX_PAGES 16
+
+static int file_rw_user(struct file *file, void *ubuf, unsigned size, off_t offset, bool write);
+
+/* O_DIRECT로 열린 파일에 대한 read/write를 직접 I/O로 처리한다.
+ * 버퍼가 페이지 정렬, 크기가 섹터 크기의 배수, 파일 위치가 섹터 정렬인 경우에만 해당한다.
+ * 버퍼의 유저 페이지들을 DIRECT_MAX_PAGES개씩 frame에 고정(pin)하고 그 kva들을 넘겨서
+ * 디스크가 유저 frame으로 바로 읽고 쓰게 한다 (연속된 섹터는 명령 하나로 처리된다).
+ * 중간에 페이지를 고정할 수 없으면 나머지는 일반 경로로 처리한다.
+ * 조건을 만족하지 않거나 처음부터 고정할 수 없으면 -1을 반환하고, 호출자가 일반 경로로 처리한다. */
+static int
+direct_rw(struct file *file, void *buffer, unsigned size, bool write)
+{
+	if (!file_is_direct(file) || pg_ofs(buffer) != 0 || size == 0
+		|| size % DISK_SECTOR_SIZE != 0 || file_tell(file) % DISK_SECTOR_SIZE != 0)
+		return -1;
+
+	void *pages[DIRECT_MAX_PAGES];
+	unsigned done = 0;
+	while (done < size)
+	{
+		unsigned chunk = size - done < DIRECT_MAX_PAGES * PGSIZE ? size - done : DIRECT_MAX_PAGES * PGSIZE;
+		size_t page_cnt = DIV_ROUND_UP(chunk, PGSIZE);
+
+		// read는 유저 메모리에 쓰는 것이므로 페이지가 writable이어야 한다.
+		size_t i;
+		for (i = 0; i < page_cnt; i++)
+		{
+			pages[i] = vm_pin_page(buffer + done + i * PGSIZE, !write);
+			if (pages[i] == NULL)
+				break;
+		}
+
+		off_t n = -1;
+		if (i == page_cnt)
+			n = write ? file_write_pages(file, pages, chunk)
+					  : file_read_pages(file, pages, chunk);
+		while (i-- > 0)
+			vm_unpin_page(buffer + done + i * PGSIZE);
+
+		if (n < 0)
+		{
+			if (done == 0)
+				return -1;
+			int rest = file_rw_user(file, buffer + done, size - done, -1, write);
+			return rest > 0 ? done + rest : done;
+		}
+		done += n;
+		if (n < (off_t)chunk)
+			break;
+	}
+	return done;
+}
+
 void close(int fd)
 {
 	struct file *file = process_get_file(fd);
@@ -244,89 +410,538 @@ void close(int fd)
 	file_close(file);
 	process_close_file(fd);
 }
-int read(int fd, void *buffer, unsigned size)
+
+// 키보드 입력 size 바이트를 유저 버퍼로 읽는다. 입력을 기다리는 동안 어떤 파일 시스템 lock도 잡지 않는다.
+static int
+console_read(void *ubuf, unsigned size)
 {
-	check_address(buffer);
+	char buf[64];
+	unsigned done = 0;
 
-	char *ptr = (char *)buffer;
-	int bytes_read = 0;
+	while (done < size)
+	{
+		unsigned chunk = size - done < sizeof buf ? size - done : sizeof buf;
+		for (unsigned i = 0; i < chunk; i++)
+			buf[i] = input_getc();
+		put_user((char *)ubuf + done, buf, chunk);
+		done += chunk;
+	}
+	return done;
+}
 
-	lock_acquire(&filesys_lock);
-	if (fd == 0)
+// 유저 버퍼의 size 바이트를 콘솔에 쓴다. 한 페이지씩 커널로 복사해 putbuf로 내보낸다.
+static int
+console_write(const void *ubuf, unsigned size)
+{
+	void *page = palloc_get_page(0);
+	if (page == NULL)
+		return -1;
+	unsigned done = 0;
+	while (done < size)
 	{
-		for (int i = 0; i < size; i++)
+		unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+		if (!copy_from_user(page, (const char *)ubuf + done, chunk))
 		{
-			*ptr++ = input_getc();
-			bytes_read++;
+			palloc_free_page(page);
+			exit(-1);
 		}
-		lock_release(&filesys_lock);
+		putbuf(page, chunk);
+		done += chunk;
 	}
-	else
+	palloc_free_page(page);
+	return done;
+}
+
+/* 파일과 유저 버퍼 사이에서 size 바이트를 커널 페이지 하나를 거쳐 옮긴다.
+ * offset이 -1이면 파일 위치에서 읽고 쓰며 위치를 진행시키고, 아니면 offset 위치에서 읽고 쓴다.
+ * 유저 메모리는 inode lock을 잡지 않은 상태에서만 건드리므로, 그 페이지를 올리다가
+ * 같은 파일을 다시 읽어야 하는 경우(자기 파일을 mmap한 버퍼 등)에도 교착 상태가 생기지 않는다.
+ * 유저 버퍼가 잘못되었으면 프로세스를 종료한다. 옮긴 바이트 수를 반환한다. */
+static int
+file_rw_user(struct file *file, void *ubuf, unsigned size, off_t offset, bool write)
+{
+	void *page = palloc_get_page(0);
+	if (page == NULL)
+		return -1;
+
+	unsigned done = 0;
+	while (done < size)
 	{
-		if (fd < 2)
+		unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+		off_t n;
+		bool ok = true;
+		if (write)
 		{
-
-			lock_release(&filesys_lock);
-			return -1;
+			ok = copy_from_user(page, (char *)ubuf + done, chunk);
+			n = !ok ? 0
+				: offset < 0 ? file_write(file, page, chunk)
+							 : file_write_at(file, page, chunk, offset + done);
 		}
-		struct file *file = process_get_file(fd);
-		if (file == NULL)
+		else
 		{
-
-			lock_release(&filesys_lock);
-			return -1;
+			n = offset < 0 ? file_read(file, page, chunk)
+						   : file_read_at(file, page, chunk, offset + done);
+			ok = n < 0 || copy_to_user((char *)ubuf + done, page, n);
+		}
+		if (n < 0) // 파이프의 반대쪽 끝이나 디렉터리
+		{
+			palloc_free_page(page);
+			return done > 0 ? (int)done : -1;
 		}
-		struct page *page = spt_find_page(&thread_current()->spt, buffer);
-		// page가 존재하고, page가 writable이 아닌 경우
-		if (page && !page->writable)
+		if (!ok)
 		{
-			lock_release(&filesys_lock);
+			palloc_free_page(page);
 			exit(-1);
 		}
-		bytes_read = file_read(file, buffer, size);
-		lock_release(&filesys_lock);
+		done += n;
+		if (n < (off_t)chunk)
+			break;
 	}
-	return bytes_read;
+	palloc_free_page(page);
+	return done;
+}
+
+int read(int fd, void *buffer, unsigned size)
+{
+	if (!is_user_range(buffer, size))
+		exit(-1);
+	// fd 0은 dup2로 다른 파일을 넣지 않았으면 키보드다.
+	struct file *file = process_get_file(fd);
+	if (file == NULL)
+		return fd == 0 ? console_read(buffer, size) : -1;
+	int bytes = direct_rw(file, buffer, size, false);
+	if (bytes != -1)
+		return bytes;
+	// inode의 reader lock만 잡으므로 다른 파일을 읽는 프로세스와 동시에 진행된다.
+	return file_rw_user(file, buffer, size, -1, false);
 }
 
 
 
 int write(int fd, const void *buffer, unsigned size)
 {
-	check_address(buffer);
-	int bytes_write = 0; // write한 바이트 수를 저장할 변수
-	if (fd == 1)
+	if (!is_user_range(buffer, size))
+		exit(-1);
+	// fd 1은 dup2로 다른 파일을 넣지 않았으면 콘솔이다.
+	struct file *file = process_get_file(fd);
+	if (file == NULL)
+		return fd == 1 ? console_write(buffer, size) : -1;
+	int bytes = direct_rw(file, (void *)buffer, size, true);
+	if (bytes != -1)
+		return bytes;
+	// inode의 writer lock으로 같은 파일에 대한 쓰기만 직렬화된다.
+	return file_rw_user(file, (void *)buffer, size, -1, true);
+}
+
+// 파일의 offset 위치에서 읽는다. 파일 위치(pos)는 바뀌지 않는다.
+int pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	if (!is_user_range(buffer, size))
+		exit(-1);
+	if (offset < 0)
+		return -1;
+	struct file *file = process_get_file(fd);
+	if (file == NULL || file_is_pipe(file)) // 파이프에는 위치가 없다.
+		return -1;
+	return file_rw_user(file, buffer, size, offset, false);
+}
+
+// 파일의 offset 위치에 쓴다. 파일 위치(pos)는 바뀌지 않는다.
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+	if (!is_user_range(buffer, size))
+		exit(-1);
+	if (offset < 0)
+		return -1;
+	struct file *file = process_get_file(fd);
+	if (file == NULL || file_is_pipe(file)) // 파이프에는 위치가 없다.
+		return -1;
+	return file_rw_user(file, (void *)buffer, size, offset, true);
+}
+
+/* 유저의 iovec 배열을 커널 메모리로 복사한다. 복사한 뒤에는 유저가 배열을 바꿔도 복사한 값만 사용된다.
+ * 각 버퍼는 옮길 때 copy_from_user/copy_to_user가 검사한다. 배열이 잘못된 주소면 프로세스를 종료하고,
+ * iovcnt가 잘못되었으면 NULL을 반환한다. */
+static struct iovec *
+copy_iovec(const struct iovec *iov, int iovcnt)
+{
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return NULL;
+
+	struct iovec *kiov = malloc(iovcnt * sizeof *kiov);
+	if (kiov == NULL)
+		return NULL;
+	if (!copy_from_user(kiov, iov, iovcnt * sizeof *kiov))
+	{
+		free(kiov);
+		exit(-1);
+	}
+	return kiov;
+}
+
+/* iovec 배열에서 다음에 옮길 위치 */
+struct iov_cursor
+{
+	const struct iovec *iov;
+	int cnt;
+	int idx;	// 지금 옮기는 버퍼
+	size_t ofs; // 그 버퍼 안의 위치
+};
+
+// 커서 위치부터 남은 바이트 수를 max까지만 센다.
+static size_t
+iov_left(const struct iov_cursor *cur, size_t max)
+{
+	size_t left = 0;
+	for (int i = cur->idx; i < cur->cnt && left < max; i++)
+		left += cur->iov[i].iov_len - (i == cur->idx ? cur->ofs : 0);
+	return left < max ? left : max;
+}
+
+// 커서 위치부터 size 바이트를 유저 버퍼들과 커널 버퍼 kbuf 사이에서 복사하고 커서를 진행시킨다.
+// to_user가 true면 kbuf에서 유저 버퍼들로 복사한다. 유저 버퍼가 잘못되었으면 false를 반환한다.
+static bool
+iov_copy(struct iov_cursor *cur, void *kbuf, size_t size, bool to_user)
+{
+	while (size > 0)
+	{
+		const struct iovec *v = &cur->iov[cur->idx];
+		size_t n = v->iov_len - cur->ofs < size ? v->iov_len - cur->ofs : size;
+		char *ubuf = (char *)v->iov_base + cur->ofs;
+		if (n > 0 && !(to_user ? copy_to_user(ubuf, kbuf, n) : copy_from_user(kbuf, ubuf, n)))
+			return false;
+		kbuf = (char *)kbuf + n;
+		size -= n;
+		cur->ofs += n;
+		if (cur->ofs == v->iov_len)
+		{
+			cur->idx++;
+			cur->ofs = 0;
+		}
+	}
+	return true;
+}
+
+/* iovec 버퍼들과 file 사이에서 데이터를 커널 페이지 page를 거쳐 한 페이지 분량씩 옮긴다.
+ * file이 NULL이면 키보드에서 읽거나 콘솔에 쓴다. 한 페이지 분량은 file_read나 file_write 한 번으로 처리하므로
+ * 합쳐서 한 페이지 이하인 iovec은 inode lock을 한 번만 잡고 처리되고, 유저 메모리는 file_rw_user처럼 lock 밖에서만 건드린다.
+ * 옮긴 바이트 수를 반환하고, 처음부터 옮길 수 없는 파일(파이프의 반대쪽 끝이나 디렉터리)이면 -1을 반환한다.
+ * 유저 버퍼가 잘못되었으면 *fault를 true로 하고 멈춘다. */
+static int
+iovec_rw(struct file *file, struct iov_cursor *cur, void *page, bool write, bool *fault)
+{
+	int total = 0;
+	size_t chunk;
+	while ((chunk = iov_left(cur, PGSIZE)) > 0)
+	{
+		off_t n = chunk;
+		if (write)
+		{
+			if (!iov_copy(cur, page, chunk, false))
+			{
+				*fault = true;
+				break;
+			}
+			if (file == NULL)
+				putbuf(page, chunk);
+			else
+				n = file_write(file, page, chunk);
+		}
+		else
+		{
+			if (file == NULL)
+				for (size_t i = 0; i < chunk; i++)
+					((char *)page)[i] = input_getc();
+			else
+				n = file_read(file, page, chunk);
+			if (n > 0 && !iov_copy(cur, page, n, true))
+			{
+				*fault = true;
+				break;
+			}
+		}
+		if (n < 0)
+			return total > 0 ? total : -1;
+		total += n;
+		if (n < (off_t)chunk)
+			break;
+	}
+	return total;
+}
+
+// readv와 writev의 공통 부분. fd 0과 1은 dup2로 다른 파일을 넣지 않았으면 키보드와 콘솔이다.
+static int
+rw_vector(int fd, const struct iovec *iov, int iovcnt, bool write)
+{
+	struct file *file = process_get_file(fd);
+	if (file == NULL && fd != (write ? 1 : 0))
+		return -1;
+	struct iovec *kiov = copy_iovec(iov, iovcnt);
+	if (kiov == NULL)
+		return -1;
+
+	int bytes = -1;
+	bool fault = false;
+	void *page = palloc_get_page(0);
+	if (page != NULL)
+	{
+		struct iov_cursor cur = {.iov = kiov, .cnt = iovcnt};
+		bytes = iovec_rw(file, &cur, page, write, &fault);
+		palloc_free_page(page);
+	}
+	free(kiov);
+	if (fault)
+		exit(-1);
+	return bytes;
+}
+
+// 여러 버퍼로 차례로 읽는다.
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	return rw_vector(fd, iov, iovcnt, false);
+}
+
+// 여러 버퍼의 내용을 이어서 쓴다. 합쳐서 한 페이지 이하면 중간에 다른 write가 끼어들지 않는다.
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return rw_vector(fd, iov, iovcnt, true);
+}
+
+/* fd_in의 현재 위치에서 size 바이트를 fd_out으로 복사한다. 두 파일의 위치가 모두 진행된다.
+ * 데이터는 커널 페이지 하나를 거쳐 옮겨지고 유저 메모리로는 넘어가지 않는다.
+ * fd_out이 콘솔인 1이면 콘솔로 보낸다 (sendfile). 복사한 바이트 수를 반환한다. */
+int copy_file_range(int fd_in, int fd_out, unsigned size)
+{
+	struct file *src = process_get_file(fd_in);
+	if (src == NULL)
+		return -1;
+	struct file *dst = process_get_file(fd_out);
+	if (dst == NULL && fd_out != 1)
+		return -1;
+	if (dst != NULL && !file_is_pipe(src) && !file_is_pipe(dst))
+		return file_copy(dst, src, size);
+
+	// 콘솔이나 파이프로는 페이지 단위로 읽어서 내보낸다.
+	void *page = palloc_get_page(0);
+	if (page == NULL)
+		return -1;
+	unsigned copied = 0;
+	while (copied < size)
+	{
+		unsigned chunk = size - copied < PGSIZE ? size - copied : PGSIZE;
+		off_t n = file_read(src, page, chunk);
+		if (n <= 0)
+			break;
+		if (dst == NULL)
+			putbuf(page, n);
+		else
+		{
+			off_t written = file_write(dst, page, n);
+			if (written < n)
+			{
+				copied += written > 0 ? written : 0;
+				break;
+			}
+		}
+		copied += n;
+		if (n < (off_t)chunk)
+			break;
+	}
+	palloc_free_page(page);
+	return copied;
+}
+
+/* fd가 가리키는 디렉터리에서 엔트리를 최대 max개 읽어 커널 버퍼 ents에 담는다.
+ * 디렉터리 위치는 파일의 pos에 엔트리 슬롯 단위로 저장해 두고 다음 호출에서 이어서 읽는다.
+ * 디렉터리가 아니면 -1, 끝에 도달했으면 0을 반환한다. */
+static int
+read_dir_entries(int fd, struct dirent *ents, int max)
+{
+	struct file *file = process_get_file(fd);
+	if (file == NULL || file_is_pipe(file) || !inode_is_dir(file_get_inode(file)))
+		return -1;
+	struct dir *dir = dir_open(inode_reopen(file_get_inode(file)));
+	if (dir == NULL)
+		return -1;
+	dir_seek(dir, file_tell(file));
+	int cnt = dir_read_entries(dir, ents, max);
+	file_seek(file, dir_tell(dir));
+	dir_close(dir);
+	return cnt;
+}
+
+// 디렉터리에서 다음 엔트리의 이름 하나를 name에 담는다.
+bool readdir(int fd, char *name)
+{
+	struct dirent ent;
+	if (read_dir_entries(fd, &ent, 1) != 1)
+		return false;
+	put_user(name, ent.d_name, strlen(ent.d_name) + 1);
+	return true;
+}
+
+/* 디렉터리 fd의 엔트리들을 유저 버퍼 ents에 들어가는 만큼 (최대 한 페이지 분량) 한 번에 채운다.
+ * 각 엔트리에는 이름과 함께 inode 번호와 종류(DT_REG/DT_DIR)가 들어간다.
+ * 채운 엔트리 수를 반환하고, 끝이면 0, 오류면 -1을 반환한다. */
+int getdents(int fd, struct dirent *ents, unsigned size)
+{
+	if (!is_user_range(ents, size))
+		exit(-1);
+	int max = size / sizeof(struct dirent);
+	if (max == 0)
+		return -1;
+	if (max > (int)(PGSIZE / sizeof(struct dirent)))
+		max = PGSIZE / sizeof(struct dirent);
+
+	struct dirent *kents = palloc_get_page(0);
+	if (kents == NULL)
+		return -1;
+	int cnt = read_dir_entries(fd, kents, max);
+	if (cnt > 0 && !copy_to_user(ents, kents, cnt * sizeof *kents))
+	{
+		palloc_free_page(kents);
+		exit(-1);
+	}
+	palloc_free_page(kents);
+	return cnt;
+}
+
+/* 파이프를 만들어 읽는 쪽 fd를 fds[0]에, 쓰는 쪽 fd를 fds[1]에 담는다.
+ * 두 fd는 fork로 자식에게 물려지고 dup2로 0, 1 자리에 넣을 수 있으므로 프로세스 사이의 파이프라인을 만들 수 있다.
+ * 성공하면 0, 실패하면 -1을 반환한다. */
+int pipe(int *fds)
+{
+	if (!is_user_range(fds, 2 * sizeof *fds))
+		exit(-1);
+	struct file *reader, *writer;
+	if (!file_open_pipe(&reader, &writer))
+		return -1;
+
+	int kfds[2];
+	kfds[0] = process_add_file(reader);
+	kfds[1] = kfds[0] != -1 ? process_add_file(writer) : -1;
+	if (kfds[1] == -1)
+	{
+		if (kfds[0] != -1)
+			process_close_file(kfds[0]);
+		file_close(reader);
+		file_close(writer);
+		return -1;
+	}
+	put_user(fds, kfds, sizeof kfds);
+	return 0;
+}
+
+/* oldfd의 파일을 newfd에도 연다. newfd에 열려 있던 파일은 먼저 닫는다.
+ * newfd가 0이나 1이면 그때부터 키보드나 콘솔 대신 그 파일을 쓴다.
+ * 두 fd는 같은 struct file을 참조 횟수로 나눠 가지므로 파일 위치도 함께 움직인다. 성공하면 newfd, 실패하면 -1. */
+int dup2(int oldfd, int newfd)
+{
+	struct file *file = process_get_file(oldfd);
+	if (file == NULL || newfd < 0 || newfd >= FDT_COUNT_LIMIT)
+		return -1;
+	if (oldfd == newfd)
+		return newfd;
+
+	close(newfd);
+	if (!process_set_file(newfd, file_share(file)))
+	{
+		file_close(file);
+		return -1;
+	}
+	return newfd;
+}
+
+// 유저 메모리에 있는 ring을 이 프로세스의 syscall ring으로 등록한다. 큐는 비운 상태로 시작한다.
+int ring_setup(struct ring *ring)
+{
+	if (!is_user_range(ring, sizeof *ring))
+		return -1;
+	unsigned zero = 0;
+	put_user(&ring->sq_head, &zero, sizeof zero);
+	put_user(&ring->sq_tail, &zero, sizeof zero);
+	put_user(&ring->cq_head, &zero, sizeof zero);
+	put_user(&ring->cq_tail, &zero, sizeof zero);
+	thread_current()->ring = ring;
+	return 0;
+}
+
+// 제출 항목 하나를 같은 이름의 syscall과 똑같이 실행하고 그 반환값을 돌려준다.
+static int
+ring_execute(const struct ring_sqe *sqe)
+{
+	switch (sqe->opcode)
 	{
-		putbuf(buffer, size);
-		bytes_write = size;
-		return size;
+	case RING_OP_NOP:
+		return 0;
+	case RING_OP_READ:
+		return read(sqe->fd, sqe->addr, sqe->len);
+	case RING_OP_WRITE:
+		return write(sqe->fd, sqe->addr, sqe->len);
+	case RING_OP_OPEN:
+		return open(sqe->addr, sqe->len);
+	case RING_OP_CLOSE:
+		close(sqe->fd);
+		return 0;
+	case RING_OP_SEEK:
+		seek(sqe->fd, sqe->len);
+		return 0;
+	default:
+		return -1;
 	}
-	else
+}
+
+/* 등록된 ring에서 제출된 항목을 최대 to_submit개까지 차례로 실행하고,
+ * 각 결과를 completion queue에 넣는다. completion queue가 가득 차면 멈춘다.
+ * 커널 진입 한 번으로 여러 syscall을 처리하므로 작은 I/O를 반복하는 프로그램의 비용이 줄어든다.
+ * 실행한 항목 수를 반환하고, 등록된 ring이 없으면 -1을 반환한다. */
+int ring_enter(unsigned to_submit)
+{
+	struct ring *ring = thread_current()->ring;
+	if (ring == NULL)
+		return -1;
+
+	// 인덱스는 호출 시작 시점의 값으로 한 번만 읽는다. head/tail 중 커널 쪽 것은 커널만 바꾼다.
+	unsigned sq_head, sq_tail, cq_head, cq_tail;
+	get_user(&sq_head, &ring->sq_head, sizeof sq_head);
+	get_user(&sq_tail, &ring->sq_tail, sizeof sq_tail);
+	get_user(&cq_head, &ring->cq_head, sizeof cq_head);
+	get_user(&cq_tail, &ring->cq_tail, sizeof cq_tail);
+
+	unsigned done = 0;
+	while (done < to_submit && sq_head != sq_tail
+		   && cq_tail - cq_head < RING_ENTRIES)
 	{
-		if (fd < 2)
-			return -1;
-		struct file *file = process_get_file(fd);
-		if (file == NULL) return -1;
-		lock_acquire(&filesys_lock);
-		bytes_write = file_write(file, buffer, size);
-		lock_release(&filesys_lock);
+		// 실행 도중 유저가 바꾸지 못하도록 항목을 먼저 복사한다.
+		struct ring_sqe sqe;
+		get_user(&sqe, &ring->sq[sq_head % RING_ENTRIES], sizeof sqe);
+		sq_head++;
+		put_user(&ring->sq_head, &sq_head, sizeof sq_head);
+
+		struct ring_cqe cqe = {.user_data = sqe.user_data};
+		cqe.res = ring_execute(&sqe);
+		put_user(&ring->cq[cq_tail % RING_ENTRIES], &cqe, sizeof cqe);
+		cq_tail++;
+		put_user(&ring->cq_tail, &cq_tail, sizeof cq_tail);
+		done++;
 	}
-	return bytes_write;
+	return done;
 }
 
 //부모 프로세스, 자식 프로세스 모두에서 호출. 부모 프로세스는 자식pid 반환, 자식은 0을 반환.
 tid_t fork(const char *thread_name, struct intr_frame *f)
 {
-	return process_fork(thread_name, f);
+	// 스레드 이름은 16바이트까지만 쓰이므로 그만큼만 복사한다.
+	char name[16];
+	get_user_string(name, thread_name, sizeof name);
+	name[sizeof name - 1] = '\0';
+	return process_fork(name, f);
 }
 
 //logic: 부모 프로세스가 fork를 호출, 자식 프로세스를 생성.
 //자식은 fork()의 반환값을 검사, 자식에서 exec를 호출해 새로운 프로그램을 실행.
 int exec(const char *cmd_line)
 {
-	// *cmd_line 의 유효성 검사
-	check_address(cmd_line);
-
 	// process.c 파일의 process_create_initd 함수와 유사하다.
 	// 단, 스레드를 새로 생성하는 건 fork에서 수행하므로
 	// 이 함수에서는 새 스레드를 생성하지 않고 process_exec을 호출한다.
@@ -338,13 +953,71 @@ int exec(const char *cmd_line)
 	cmd_line_cpy = palloc_get_page(0);
 	if (cmd_line_cpy == NULL)
 		exit(-1);							  // 메모리 할당 실패 시 status -1로 종료한다.
-	strlcpy(cmd_line_cpy, cmd_line, PGSIZE); // cmd_line을 복사한다.
+	// cmd_line을 복사한다. 잘못된 주소면 status -1로 종료하고, 너무 길면 잘라낸다.
+	if (strncpy_from_user(cmd_line_cpy, cmd_line, PGSIZE) < 0)
+	{
+		palloc_free_page(cmd_line_cpy);
+		exit(-1);
+	}
+	cmd_line_cpy[PGSIZE - 1] = '\0';
 
 	// 스레드의 이름을 변경하지 않고 바로 실행한다.
 	if (process_exec(cmd_line_cpy) == -1)
 		exit(-1); // 실패 시 status -1로 종료한다.
 }
 
+/* cmd_line을 실행하는 자식 프로세스를 만든다. fork 후 exec하는 것과 같지만 부모의 주소 공간을 복사하지 않는다.
+ * fds가 NULL이면 fork처럼 열린 fd를 모두 물려주고, 아니면 자식의 fd i에 부모의 fds[i]를 연다 (fd_cnt개, -1이면 비워 둔다).
+ * 자식의 0, 1이 비어 있으면 키보드와 콘솔을 쓴다. 자식의 pid를, 로드에 실패하면 -1을 반환한다. */
+tid_t spawn(const char *cmd_line, const int *fds, int fd_cnt)
+{
+	struct thread *curr = thread_current();
+	if (fds == NULL)
+		fd_cnt = curr->fdt_size;
+	if (fd_cnt < 0 || fd_cnt > FDT_COUNT_LIMIT)
+		return -1;
+	if (fds != NULL && !is_user_range(fds, fd_cnt * sizeof *fds))
+		exit(-1);
+
+	// 물려줄 fd가 없으면 (fd_cnt == 0) files를 만들지 않는다. kfds는 fds를 받았을 때만 쓴다.
+	char *cmd_line_cpy = palloc_get_page(0);
+	struct file **files = NULL;
+	int *kfds = NULL;
+	bool ok = cmd_line_cpy != NULL;
+	if (ok && fd_cnt > 0)
+	{
+		files = calloc(fd_cnt, sizeof *files);
+		if (fds != NULL)
+			kfds = malloc(fd_cnt * sizeof *kfds);
+		ok = files != NULL && (fds == NULL || kfds != NULL);
+	}
+	// 잘못된 주소면 할당한 것을 돌려준 뒤 status -1로 종료한다.
+	bool fault = ok && (strncpy_from_user(cmd_line_cpy, cmd_line, PGSIZE) < 0 ||
+						(kfds != NULL && !copy_from_user(kfds, fds, fd_cnt * sizeof *kfds)));
+	for (int i = 0; ok && !fault && i < fd_cnt; i++)
+	{
+		struct file *file = process_get_file(kfds != NULL ? kfds[i] : i);
+		if (file != NULL && (files[i] = file_duplicate(file)) == NULL)
+			ok = false;
+	}
+	free(kfds);
+	if (!ok || fault)
+	{
+		for (int i = 0; files != NULL && i < fd_cnt; i++)
+			file_close(files[i]);
+		free(files);
+		palloc_free_page(cmd_line_cpy);
+		if (fault)
+			exit(-1);
+		return -1;
+	}
+	cmd_line_cpy[PGSIZE - 1] = '\0';
+
+	tid_t pid = process_spawn(cmd_line_cpy, files, fd_cnt);
+	free(files);
+	return pid;
+}
+
 int wait(int pid)
 {
 /* 
@@ -370,6 +1043,20 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 	if (spt_find_page(&thread_current()->spt, addr))
 		return NULL;
 
+	// 커널 데이터 페이지(vdso)와 겹치는 매핑은 허용하지 않는다.
+	if ((uint64_t)addr < VDSO_ADDR + VDSO_SIZE && VDSO_ADDR < (uint64_t)addr + length)
+		return NULL;
+
+	// fd가 -1이면 파일 없이 0으로 채워진 anonymous 메모리를 매핑한다.
+	if (fd == -1)
+	{
+		size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+		if ((int)length <= 0 || offset != 0 || !vm_alloc_anon(addr, page_cnt, writable))
+			return NULL;
+		spt_find_page(&thread_current()->spt, addr)->mapped_page_count = page_cnt;
+		return addr;
+	}
+
 	struct file *f = process_get_file(fd); // 파일 디스크립터로부터 파일을 가져옴
 	if (f == NULL)
 		return NULL;
@@ -383,4 +1070,67 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 void munmap(void *addr)
 {
 	do_munmap(addr);
-}
\ No newline at end of file
+}
+
+/* heap의 끝(break)을 increment 바이트 옮기고 이전 break를 반환한다. 실패하면 (void *) -1을 반환한다.
+ * heap은 실행 파일의 마지막 세그먼트 바로 뒤에서 시작해 커널 데이터 페이지(vdso) 아래까지 자랄 수 있다.
+ * 새 페이지는 처음 접근할 때 0으로 채워지고, 줄어들어 통째로 빈 페이지는 바로 해제한다. */
+void *sbrk(intptr_t increment)
+{
+	struct thread *curr = thread_current();
+	uint64_t old_brk = (uint64_t)curr->heap_end;
+	if (increment < 0 ? (uint64_t)-increment > old_brk - (uint64_t)curr->heap_start
+					  : (uint64_t)increment > VDSO_ADDR - old_brk)
+		return (void *)-1;
+
+	uint64_t new_brk = old_brk + increment;
+	uint64_t old_top = ROUND_UP(old_brk, PGSIZE);
+	uint64_t new_top = ROUND_UP(new_brk, PGSIZE);
+	if (new_top > old_top && !vm_alloc_anon((void *)old_top, (new_top - old_top) / PGSIZE, true))
+		return (void *)-1;
+	if (new_top < old_top)
+		vm_release_pages((void *)new_top, (old_top - new_top) / PGSIZE);
+
+	curr->heap_end = (void *)new_brk;
+	return (void *)old_brk;
+}
+
+/* addr부터 length 바이트에 공유 메모리를 매핑한다. name이 NULL이면 fork한 자식과 공유되는 이름 없는 메모리를,
+ * 아니면 그 이름의 공유 메모리 객체를 매핑한다 (없으면 만든다). 해제는 munmap으로 한다. */
+void *shm_map_syscall(void *addr, size_t length, const char *name)
+{
+	if (!addr || addr != pg_round_down(addr) || (int)length <= 0)
+		return NULL;
+	if (!is_user_vaddr(addr) || !is_user_vaddr(addr + length))
+		return NULL;
+	if ((uint64_t)addr < VDSO_ADDR + VDSO_SIZE && VDSO_ADDR < (uint64_t)addr + length)
+		return NULL;
+
+	char kname[SHM_NAME_MAX + 1];
+	if (name != NULL && !get_user_string(kname, name, sizeof kname))
+		return NULL;
+	return shm_map(addr, length, name != NULL ? kname : NULL);
+}
+
+// 공유 메모리 객체의 이름을 지운다. 이미 매핑한 프로세스들은 munmap할 때까지 계속 쓸 수 있다.
+bool shm_unlink_syscall(const char *name)
+{
+	char kname[SHM_NAME_MAX + 1];
+	if (!get_user_string(kname, name, sizeof kname))
+		return false;
+	return shm_unlink(kname);
+}
+
+/* 시스템 콜별 통계를 시스템 콜 번호 순서로 buf에 최대 cnt개 복사한다. 시스템 콜 번호의 개수를 반환한다. */
+int syscall_stats(struct syscall_stat *buf, unsigned cnt)
+{
+	struct syscall_stat copy[SYS_CNT];
+	if (cnt > SYS_CNT)
+		cnt = SYS_CNT;
+
+	enum intr_level old_level = intr_disable();
+	memcpy(copy, stats, sizeof copy);
+	intr_set_level(old_level);
+	put_user(buf, copy, cnt * sizeof *copy);
+	return SYS_CNT;
+}
@@ -0,0 +1,76 @@
+#include "userprog/usercopy.h"
+#include <stdint.h>
+#include <vdso.h>
+#include "threads/vaddr.h"
+
+/* Copying primitives in usercopy-asm.S.  A fault on a bad user
+ * address makes them return early instead of killing the
+ * process; see the fixup table in exception.c. */
+size_t usercopy_memcpy (void *dst, const void *src, size_t n);
+long usercopy_strncpy (char *dst, const char *src, size_t n);
+
+/* Returns true if the SIZE bytes starting at UADDR, or the single
+ * address UADDR if SIZE is 0, lie in user memory.  Says nothing
+ * about whether they are mapped: the copy functions below find
+ * that out as they go. */
+bool
+is_user_range (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+
+	if (uaddr == NULL || !is_user_vaddr (uaddr))
+		return false;
+	return size == 0
+		|| (start + size > start && is_user_vaddr (start + size - 1));
+}
+
+/* Returns true if the SIZE bytes at user address UADDR overlap
+ * the vDSO pages.  Their data page is one kernel page shared by
+ * every process, so no copy may ever write into it. */
+static bool
+overlaps_vdso (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+
+	return start < VDSO_ADDR + VDSO_SIZE && start + size > VDSO_ADDR;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST,
+ * in one pass.  Returns true if successful, false if any part of
+ * the source is not valid, readable user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	return is_user_range (usrc, size)
+		&& usercopy_memcpy (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST,
+ * in one pass.  Returns true if successful, false if any part of
+ * the destination is not valid, writable user memory, which the
+ * vDSO pages never are. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	return is_user_range (udst, size) && !overlaps_vdso (udst, size)
+		&& usercopy_memcpy (udst, src, size) == 0;
+}
+
+/* Copies the string at user address USRC, with its null
+ * terminator, into the SIZE-byte kernel buffer DST.
+ * Returns the string's length if successful, SIZE if the string
+ * does not fit (DST then holds a prefix without a terminator), or
+ * -1 if the string is not in valid user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	uintptr_t start = (uintptr_t) usrc;
+	size_t limit = size;
+	long len;
+
+	if (!is_user_range (usrc, 0))
+		return -1;
+
+	/* Never read past the end of user memory. */
+	if (limit > KERN_BASE - start)
+		limit = KERN_BASE - start;
+	len = usercopy_strncpy (dst, usrc, limit);
+	if (len < 0 || (size_t) len == limit)
+		return limit < size ? -1 : (int) size;
+	return len;
+}
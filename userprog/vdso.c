@@ -0,0 +1,87 @@
+#include "userprog/vdso.h"
+#include <debug.h>
+#include <vdso.h>
+#include "devices/timer.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#include "vm/vm.h"
+
+/* The kernel data page shared by all processes.  See lib/vdso.h
+ * for its layout and where it is mapped. */
+static struct vdso_data *vdso_data;
+
+/* Sets up the kernel data page.  Must be called after
+ * timer_calibrate(). */
+void
+vdso_init (void) {
+	vdso_data = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	vdso_data->timer_freq = TIMER_FREQ;
+	vdso_data->tsc_per_tick = timer_tsc_per_tick ();
+	vdso_data->tsc_boot = rdtsc ();
+	vdso_data->ticks = timer_ticks ();
+}
+
+/* Publishes TICKS, the new time, to user processes.  Called by
+ * the timer interrupt handler. */
+void
+vdso_tick (int64_t ticks) {
+	if (vdso_data != NULL)
+		vdso_data->ticks = ticks;
+}
+
+/* Maps the kernel data page and a new per-process page, both
+ * read-only, at VDSO_ADDR in T's address space.
+ * Returns true if successful, false if memory allocation fails
+ * or the address range is already in use. */
+bool
+vdso_map (struct thread *t) {
+	uint8_t *upage = (uint8_t *) VDSO_ADDR;
+	struct vdso_proc *proc;
+
+	ASSERT (vdso_data != NULL);
+
+	if (pml4_get_page (t->pml4, upage) != NULL
+			|| pml4_get_page (t->pml4, upage + PGSIZE) != NULL)
+		return false;
+#ifdef VM
+	if (spt_find_page (&t->spt, upage) != NULL
+			|| spt_find_page (&t->spt, upage + PGSIZE) != NULL)
+		return false;
+#endif
+
+	proc = palloc_get_page (PAL_ZERO);
+	if (proc == NULL)
+		return false;
+	proc->tid = t->tid;
+
+	if (!pml4_set_page (t->pml4, upage, vdso_data, false)) {
+		palloc_free_page (proc);
+		return false;
+	}
+	if (!pml4_set_page (t->pml4, upage + PGSIZE, proc, false)) {
+		pml4_clear_page (t->pml4, upage);
+		palloc_free_page (proc);
+		return false;
+	}
+	return true;
+}
+
+/* Removes the pages that vdso_map() put in T's address space, if
+ * any, and frees T's per-process page.  Must be called before T's
+ * page table is destroyed, which would otherwise free the shared
+ * page along with it. */
+void
+vdso_unmap (struct thread *t) {
+	uint8_t *upage = (uint8_t *) VDSO_ADDR;
+	void *proc = pml4_get_page (t->pml4, upage + PGSIZE);
+
+	if (pml4_get_page (t->pml4, upage) == vdso_data)
+		pml4_clear_page (t->pml4, upage);
+	if (proc != NULL) {
+		pml4_clear_page (t->pml4, upage + PGSIZE);
+		palloc_free_page (proc);
+	}
+}
@@ -52,26 +52,20 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
-static bool
-anon_swap_in (struct page *page, void *kva) {
-	struct anon_page *anon_page = &page->anon;
-	disk_sector_t page_slot_no = anon_page->slot_no; // page가 저장된 slot_no
+/* slot_no번 slot의 내용을 kva로 읽고 slot을 비운다. 그런 slot이 없으면 false를 반환한다. */
+bool
+swap_read (uint32_t slot_no, void *kva) {
 	struct list_elem *e;
 	struct slot *slot;
 	lock_acquire(&swap_table_lock);
 	for (e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e))
 	{
 		slot = list_entry(e, struct slot, swap_elem);
-		if (slot->slot_no == page_slot_no) // 현재 page가 사용중인 slot 찾기
+		if (slot->slot_no == slot_no) // 현재 page가 사용중인 slot 찾기
 		{
-			for (int i = 0; i < 8; i++)
-			{
-				// 디스크, 읽을 섹터 번호, 담을 주소 (512bytes씩 읽는다. disk 관련은 동기화 처리가 되어 있어서 lock 불필요)
-				disk_read(swap_disk, page_slot_no * 8 + i, kva + DISK_SECTOR_SIZE * i);
-			}
-			slot->page = NULL;		 // 빈 slot으로 업데이트한다.
-			anon_page->slot_no = -1; // 이제 이 page는 swap_slot을 차지하지 않는다.
+			// 디스크, 읽을 섹터 번호, 담을 주소 (한 페이지 = 8섹터를 한 번에 읽는다. DMA가 가능하면 명령 하나로 처리된다.)
+			disk_read_sectors(swap_disk, slot_no * 8, kva, 8);
+			slot->page = NULL; // 빈 slot으로 업데이트한다.
 			lock_release(&swap_table_lock);
 			return true;
 		}
@@ -80,13 +74,9 @@ anon_swap_in (struct page *page, void *kva) {
 	return false;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
-static bool
-anon_swap_out (struct page *page) {
-	// struct anon_page *anon_page = &page->anon;
-	if (page == NULL)
-		return false;
-	struct anon_page *anon_page = &page->anon;
+/* kva의 한 페이지를 빈 slot에 쓰고 그 slot 번호를 반환한다. page는 slot을 차지하는 page다. */
+uint32_t
+swap_write (struct page *page, void *kva) {
 	struct list_elem *e;
 	struct slot *slot;
 	lock_acquire(&swap_table_lock);
@@ -95,39 +85,27 @@ anon_swap_out (struct page *page) {
 		slot = list_entry(e, struct slot, swap_elem);
 		if (slot->page == NULL) // page가 NULL인 slot 찾기
 		{
-			for (int i = 0; i < 8; i++)
-			{ // 찾은 slot에 page의 내용 저장
-				disk_write(swap_disk, slot->slot_no * 8 + i, page->va + DISK_SECTOR_SIZE * i);
-			}
-			anon_page->slot_no = slot->slot_no;
+			// 찾은 slot에 page의 내용 저장 (kva에서 8섹터를 한 번에 쓴다.)
+			disk_write_sectors(swap_disk, slot->slot_no * 8, kva, 8);
 			slot->page = page;
-			// page와 frame의 연결을 끊는다.
-			page->frame->page = NULL;
-			page->frame = NULL;
-			pml4_clear_page(thread_current()->pml4, page->va);
 			lock_release(&swap_table_lock);
-			return true;
+			return slot->slot_no;
 		}
 	}
 	lock_release(&swap_table_lock);
 	PANIC("insufficient swap space"); // 디스크에 더 이상 빈 슬롯이 없는 경우
 }
 
-/* Destroy the anonymous page. PAGE will be freed by the caller. */
-static void
-anon_destroy (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
-	// anonymous page에 의해 유지되던 리소스를 해제합니다.
-	// page struct를 명시적으로 해제할 필요는 없으며, 호출자가 이를 수행해야 합니다.
+/* slot_no번 slot을 비운다. -1이면 아무것도 하지 않는다. */
+void
+swap_free (uint32_t slot_no) {
 	struct list_elem *e;
 	struct slot *slot;
-
-	// 차지하던 slot 반환
 	lock_acquire(&swap_table_lock);
 	for (e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e))
 	{
 		slot = list_entry(e, struct slot, swap_elem);
-		if (slot->slot_no == anon_page->slot_no)
+		if (slot->slot_no == slot_no)
 		{
 			slot->page = NULL;
 			break;
@@ -135,3 +113,35 @@ anon_destroy (struct page *page) {
 	}
 	lock_release(&swap_table_lock);
 }
+
+/* Swap in the page by read contents from the swap disk. */
+static bool
+anon_swap_in (struct page *page, void *kva) {
+	struct anon_page *anon_page = &page->anon;
+	if (!swap_read(anon_page->slot_no, kva))
+		return false;
+	anon_page->slot_no = -1; // 이제 이 page는 swap_slot을 차지하지 않는다.
+	return true;
+}
+
+/* Swap out the page by writing contents to the swap disk. */
+static bool
+anon_swap_out (struct page *page) {
+	if (page == NULL)
+		return false;
+	struct anon_page *anon_page = &page->anon;
+	anon_page->slot_no = swap_write(page, page->frame->kva);
+	// page와 frame의 연결을 끊는다.
+	page->frame->page = NULL;
+	page->frame = NULL;
+	pml4_clear_page(thread_current()->pml4, page->va);
+	return true;
+}
+
+/* Destroy the anonymous page. PAGE will be freed by the caller. */
+static void
+anon_destroy (struct page *page) {
+	// anonymous page에 의해 유지되던 리소스를 해제합니다.
+	// page struct를 명시적으로 해제할 필요는 없으며, 호출자가 이를 수행해야 합니다.
+	swap_free(page->anon.slot_no); // 차지하던 slot 반환
+}
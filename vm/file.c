@@ -55,9 +55,10 @@ static bool
 file_backed_swap_out(struct page *page)
 {
 	struct file_page *file_page UNUSED = &page->file;
-	if (pml4_is_dirty(thread_current()->pml4, page->va))
+	// 유저 주소로 쓰면 inode lock을 잡은 채 page fault가 날 수 있으므로 frame의 커널 주소로 쓴다.
+	if (page->frame != NULL && pml4_is_dirty(thread_current()->pml4, page->va))
 	{
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->ofs);
+		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->ofs);
 		pml4_set_dirty(thread_current()->pml4, page->va, 0);
 	}
 
@@ -75,9 +76,9 @@ file_backed_destroy(struct page *page)
 {
 	// page struct를 해제할 필요는 없습니다. (file_backed_destroy의 호출자가 해야 함)
 	struct file_page *file_page UNUSED = &page->file;
-	if (pml4_is_dirty(thread_current()->pml4, page->va))
+	if (page->frame != NULL && pml4_is_dirty(thread_current()->pml4, page->va))
 	{
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->ofs);
+		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->ofs);
 		pml4_set_dirty(thread_current()->pml4, page->va, 0);
 	}
 	pml4_clear_page(thread_current()->pml4, page->va);
@@ -150,7 +151,11 @@ void do_munmap(void *addr)
 	int count = p->mapped_page_count;
 	for (int i = 0; i < count; i++)
 	{
-		if (p) destroy(p);
+		if (p && page_get_type(p) == VM_SHM) // 공유 메모리 page는 spt에서 빼야 객체의 참조가 정리된다.
+			spt_remove_page(spt, p);
+		else if (p && page_get_type(p) == VM_ANON) // anonymous mmap은 frame을 돌려주고 page를 지운다.
+			vm_release_pages(p->va, 1);
+		else if (p) destroy(p);
 		// {
 		// 	if (pml4_get_page(thread_current()->pml4, p->va))
 		// 		// 매핑된 프레임이 있다면 = swap out 되지 않았다면 -> 페이지를 제거하고 연결된 프레임도 제거
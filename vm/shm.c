@@ -0,0 +1,308 @@
+/* shm.c: Implementation of shared anonymous memory.
+ *
+ * 공유 메모리 객체는 여러 프로세스가 같은 frame을 매핑하는 anonymous 메모리다.
+ * 객체의 페이지마다 shm_slot이 하나씩 있고, 메모리에 있으면 그 frame을, swap되어 있으면
+ * swap slot 번호를 가진다. slot은 자신을 매핑한 page들의 목록도 가지고 있어서,
+ * 한 프로세스가 올린 frame은 모든 매퍼의 pml4에 매핑되고, 쫓겨날 때는 모든 매핑이 함께 지워진다. */
+
+#include "vm/vm.h"
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_SHM,
+};
+
+/* 공유 메모리 객체의 한 페이지 */
+struct shm_slot {
+	struct frame *frame; // 메모리에 있으면 그 frame, 없으면 NULL
+	uint32_t slot_no;	 // swap되어 있으면 swap slot 번호, 아니면 -1
+	struct list mappers; // 이 페이지를 매핑한 page들 (shm_page.mapper_elem)
+};
+
+/* 공유 메모리 객체 */
+struct shm {
+	struct list_elem elem;		 // shm_list
+	char name[SHM_NAME_MAX + 1]; // 이름 없는 객체와 unlink된 객체는 빈 문자열
+	int ref_cnt;				 // 이름 하나와 매핑된 page 수를 합친 참조 수
+	size_t page_cnt;
+	struct shm_slot slots[];
+};
+
+static struct list shm_list; // 이름이 있는 객체들
+static struct lock shm_lock; // shm_list와 모든 객체의 slot, ref_cnt를 보호한다.
+
+/* 공유 메모리 하위 시스템을 초기화한다. */
+void
+vm_shm_init (void) {
+	list_init(&shm_list);
+	lock_init(&shm_lock);
+}
+
+/* 이름이 name인 객체를 찾는다. shm_lock을 잡고 호출해야 한다. */
+static struct shm *
+shm_lookup (const char *name) {
+	struct list_elem *e;
+	for (e = list_begin(&shm_list); e != list_end(&shm_list); e = list_next(e))
+	{
+		struct shm *shm = list_entry(e, struct shm, elem);
+		if (!strcmp(shm->name, name))
+			return shm;
+	}
+	return NULL;
+}
+
+/* page_cnt 페이지짜리 객체를 만든다. name이 NULL이 아니면 shm_list에 등록하고 이름이 참조 하나를 가진다.
+ * shm_lock을 잡고 호출해야 한다. */
+static struct shm *
+shm_create (const char *name, size_t page_cnt) {
+	struct shm *shm = malloc(sizeof *shm + page_cnt * sizeof *shm->slots);
+	if (shm == NULL)
+		return NULL;
+	shm->name[0] = '\0';
+	shm->ref_cnt = 0;
+	shm->page_cnt = page_cnt;
+	for (size_t i = 0; i < page_cnt; i++)
+	{
+		shm->slots[i].frame = NULL;
+		shm->slots[i].slot_no = -1;
+		list_init(&shm->slots[i].mappers);
+	}
+	if (name != NULL)
+	{
+		strlcpy(shm->name, name, sizeof shm->name);
+		shm->ref_cnt++;
+		list_push_back(&shm_list, &shm->elem);
+	}
+	return shm;
+}
+
+/* 객체의 참조 하나를 놓는다. 마지막 참조였다면 swap slot들과 함께 객체를 해제한다.
+ * 매퍼가 모두 떠난 뒤이므로 메모리에 남은 frame은 없다. shm_lock을 잡고 호출해야 한다. */
+static void
+shm_release (struct shm *shm) {
+	if (--shm->ref_cnt > 0)
+		return;
+	for (size_t i = 0; i < shm->page_cnt; i++)
+		swap_free(shm->slots[i].slot_no);
+	free(shm);
+}
+
+/* 공유 메모리 page를 초기화한다. aux는 매핑할 객체와 페이지 번호를 담은 shm_page다.
+ * slot이 이미 메모리에 있으면 바로 그 frame을 매핑한다. */
+bool
+shm_initializer (struct page *page, enum vm_type type UNUSED, void *kva UNUSED) {
+	// uninit과 shm은 union을 공유하므로 aux를 먼저 읽어 둔다.
+	struct shm_page *aux = page->uninit.aux;
+	struct shm *shm = aux->shm;
+	size_t idx = aux->idx;
+
+	page->operations = &shm_ops;
+	struct shm_page *shm_page = &page->shm;
+	shm_page->shm = shm;
+	shm_page->idx = idx;
+	shm_page->pml4 = thread_current()->pml4;
+
+	lock_acquire(&shm_lock);
+	struct shm_slot *slot = &shm->slots[idx];
+	shm->ref_cnt++;
+	list_push_back(&slot->mappers, &shm_page->mapper_elem);
+	if (slot->frame != NULL && pml4_set_page(shm_page->pml4, page->va, slot->frame->kva, page->writable))
+	{
+		page->frame = slot->frame;
+		slot->frame->ref_cnt++;
+	}
+	lock_release(&shm_lock);
+	return true;
+}
+
+/* 현재 프로세스의 upage에 shm의 idx번째 페이지를 매핑한다. fork할 때 자식에게 매핑을 물려줄 때도 쓴다. */
+bool
+shm_map_page (void *upage, struct shm *shm, size_t idx) {
+	struct shm_page aux = {.shm = shm, .idx = idx};
+	if (!vm_alloc_page_with_initializer(VM_SHM, upage, true, NULL, &aux))
+		return false;
+	// file page를 fork할 때처럼, 기다리지 않고 바로 공유 메모리 page로 바꾼다.
+	return shm_initializer(spt_find_page(&thread_current()->spt, upage), VM_SHM, NULL);
+}
+
+/* addr부터 length 바이트에 공유 메모리를 매핑한다.
+ * name이 NULL이면 이름 없는 객체를 새로 만들고, 이 객체는 fork한 자식과만 공유된다.
+ * 아니면 그 이름의 객체를 매핑하고, 없으면 length 크기로 만든다.
+ * 성공하면 addr을, 실패하면 NULL을 반환한다. */
+void *
+shm_map (void *addr, size_t length, const char *name) {
+	size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+	lock_acquire(&shm_lock);
+	struct shm *shm = name != NULL ? shm_lookup(name) : NULL;
+	if (shm == NULL)
+		shm = shm_create(name, page_cnt);
+	else if (page_cnt > shm->page_cnt)
+		shm = NULL;
+	if (shm != NULL)
+		shm->ref_cnt++; // 매핑하는 동안 객체가 사라지지 않게 잡아 둔다.
+	lock_release(&shm_lock);
+	if (shm == NULL)
+		return NULL;
+
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	size_t i;
+	for (i = 0; i < page_cnt; i++)
+		if (!shm_map_page(addr + i * PGSIZE, shm, i))
+			break;
+	if (i == page_cnt)
+		spt_find_page(spt, addr)->mapped_page_count = page_cnt;
+	else
+		while (i-- > 0)
+			spt_remove_page(spt, spt_find_page(spt, addr + i * PGSIZE));
+
+	lock_acquire(&shm_lock);
+	shm_release(shm);
+	lock_release(&shm_lock);
+	return i == page_cnt ? addr : NULL;
+}
+
+/* 이름이 name인 객체의 이름을 지운다. 객체는 매핑이 모두 사라질 때 해제된다. */
+bool
+shm_unlink (const char *name) {
+	lock_acquire(&shm_lock);
+	struct shm *shm = shm_lookup(name);
+	if (shm != NULL)
+	{
+		list_remove(&shm->elem);
+		shm->name[0] = '\0';
+		shm_release(shm);
+	}
+	lock_release(&shm_lock);
+	return shm != NULL;
+}
+
+/* slot의 내용을 kva에 올리고, 이 slot을 매핑한 다른 page들에도 같은 frame을 매핑한다.
+ * 그 사이 다른 매퍼가 먼저 올렸다면 받은 frame은 빈 frame으로 돌려놓고 이미 있는 frame을 매핑한다. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_page *shm_page = &page->shm;
+
+	lock_acquire(&shm_lock);
+	struct shm_slot *slot = &shm_page->shm->slots[shm_page->idx];
+	if (slot->frame != NULL)
+	{
+		page->frame->page = NULL;
+		page->frame->ref_cnt = 0;
+		page->frame = slot->frame;
+		slot->frame->ref_cnt++;
+		pml4_clear_page(shm_page->pml4, page->va);
+		pml4_set_page(shm_page->pml4, page->va, slot->frame->kva, page->writable);
+		lock_release(&shm_lock);
+		return true;
+	}
+
+	if (slot->slot_no != (uint32_t)-1)
+	{
+		swap_read(slot->slot_no, kva);
+		slot->slot_no = -1;
+	}
+	else
+		memset(kva, 0, PGSIZE);
+	slot->frame = page->frame;
+
+	struct list_elem *e;
+	for (e = list_begin(&slot->mappers); e != list_end(&slot->mappers); e = list_next(e))
+	{
+		struct page *other = list_entry(e, struct page, shm.mapper_elem);
+		if (other->frame == NULL && pml4_set_page(other->shm.pml4, other->va, kva, other->writable))
+		{
+			other->frame = slot->frame;
+			slot->frame->ref_cnt++;
+		}
+	}
+	lock_release(&shm_lock);
+	return true;
+}
+
+/* slot의 내용을 swap에 쓰고, 이 frame을 매핑한 모든 page의 매핑을 지운다. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_page *shm_page = &page->shm;
+
+	lock_acquire(&shm_lock);
+	struct shm_slot *slot = &shm_page->shm->slots[shm_page->idx];
+	struct frame *frame = slot->frame;
+	if (frame == NULL)
+	{
+		lock_release(&shm_lock);
+		return false;
+	}
+	slot->slot_no = swap_write(page, frame->kva);
+
+	struct list_elem *e;
+	for (e = list_begin(&slot->mappers); e != list_end(&slot->mappers); e = list_next(e))
+	{
+		struct page *other = list_entry(e, struct page, shm.mapper_elem);
+		if (other->frame == frame)
+		{
+			pml4_clear_page(other->shm.pml4, other->va);
+			other->frame = NULL;
+		}
+	}
+	frame->page = NULL;
+	frame->ref_cnt = 0;
+	slot->frame = NULL;
+	lock_release(&shm_lock);
+	return true;
+}
+
+/* page를 slot의 매퍼에서 빼고 객체의 참조를 놓는다.
+ * 공유 frame은 pml4_destroy가 해제하지 않도록 매핑을 먼저 지운다.
+ * 마지막 매퍼였다면 frame을 빈 frame으로 돌려놓고, 객체가 남아 있으면 내용은 swap에 보관한다. */
+static void
+shm_destroy (struct page *page) {
+	struct shm_page *shm_page = &page->shm;
+	struct shm *shm = shm_page->shm;
+
+	lock_acquire(&shm_lock);
+	struct shm_slot *slot = &shm->slots[shm_page->idx];
+	list_remove(&shm_page->mapper_elem);
+
+	struct frame *frame = page->frame;
+	if (frame != NULL)
+	{
+		pml4_clear_page(shm_page->pml4, page->va);
+		page->frame = NULL;
+		if (--frame->ref_cnt == 0)
+		{
+			if (shm->ref_cnt > 1)
+				slot->slot_no = swap_write(page, frame->kva);
+			frame->page = NULL;
+			slot->frame = NULL;
+		}
+		else if (frame->page == page)
+		{
+			// eviction이 이 frame을 고르면 남은 매퍼를 통해 쫓아내도록 한다.
+			struct list_elem *e;
+			for (e = list_begin(&slot->mappers); e != list_end(&slot->mappers); e = list_next(e))
+			{
+				struct page *other = list_entry(e, struct page, shm.mapper_elem);
+				if (other->frame == frame)
+				{
+					frame->page = other;
+					break;
+				}
+			}
+		}
+	}
+	shm_release(shm);
+	lock_release(&shm_lock);
+}
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "userprog/process.h"
 
 static bool uninit_initialize(struct page *page, void *kva);
 static void uninit_destroy(struct page *page);
@@ -69,10 +70,11 @@ uninit_initialize(struct page *page, void *kva)
 static void
 uninit_destroy(struct page *page)
 {
-	struct uninit_page *uninit UNUSED = &page->uninit;
+	struct uninit_page *uninit = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
 	// page struct에 의해 유지되고 있던 리소스를 해제합니다.
 	// 페이지의 vm 유형을 확인하고 그에 맞게 처리하는 것이 좋습니다.
-
+	// 한 번도 로드되지 않은 실행 파일 세그먼트 페이지면 aux 묶음의 참조를 놓는다.
+	segment_aux_release(uninit->init, uninit->aux);
 }
\ No newline at end of file
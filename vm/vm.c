@@ -3,6 +3,8 @@
 #include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include <string.h>
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "userprog/process.h"
@@ -21,6 +23,7 @@ void vm_init(void)
 	/* TODO: Your code goes here. */
 	list_init(&frame_table);
 	lock_init(&frame_table_lock);
+	vm_shm_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -77,6 +80,9 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		case VM_FILE:
 			page_initializer = file_backed_initializer;
 			break;
+		case VM_SHM:
+			page_initializer = shm_initializer;
+			break;
 		}
 		// uninit_new를 호출해 "uninit" 페이지 구조체를 생성하세요.
 		uninit_new(p, upage, init, type, aux, page_initializer);
@@ -124,7 +130,9 @@ void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Get the struct frame, that will be evicted.
+ * 고른 frame은 lock을 놓기 전에 고정해서, 쫓아내는 동안 다른 스레드가 고르거나 고정하지 못하게 한다.
+ * 모든 frame이 고정되어 있으면 NULL을 반환한다. */
 static struct frame *
 vm_get_victim(void)
 {
@@ -133,25 +141,36 @@ vm_get_victim(void)
 	struct thread *curr = thread_current();
 
 	lock_acquire(&frame_table_lock);
+	struct frame *fallback = NULL; // 모든 frame이 최근에 접근된 경우 쫓아낼 frame
 	struct list_elem *start = list_begin(&frame_table);
 	for (start; start != list_end(&frame_table); start = list_next(start))
 	{
 		victim = list_entry(start, struct frame, frame_elem);
+		if (victim->pinned) // direct I/O 중이거나 다른 스레드가 쫓아내거나 채우는 중인 frame은 건너뛴다.
+			continue;
 		if (victim->page == NULL) // frame에 할당된 페이지가 없는 경우 (page가 destroy된 경우 )
 		{
+			victim->pinned = true;
 			lock_release(&frame_table_lock);
 			return victim;
 		}
 		if (pml4_is_accessed(curr->pml4, victim->page->va))
+		{
 			pml4_set_accessed(curr->pml4, victim->page->va, 0);
+			if (fallback == NULL)
+				fallback = victim;
+		}
 		else
 		{
+			victim->pinned = true;
 			lock_release(&frame_table_lock);
 			return victim;
 		}
 	}
+	if (fallback != NULL)
+		fallback->pinned = true;
 	lock_release(&frame_table_lock);
-	return victim;
+	return fallback;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -161,15 +180,18 @@ vm_evict_frame(void)
 {
 	struct frame *victim = vm_get_victim();
 	/* TODO: swap out the victim and return the evicted frame. */
+	if (victim == NULL)
+		return NULL;
 	if (victim->page)
 		swap_out(victim->page);
 	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it. That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space.
+ * 돌려주는 frame은 고정되어 있으므로, 채운 뒤 호출자가 고정을 풀어야 한다.
+ * 모든 frame이 고정되어 있어 쫓아낼 수 없으면 NULL을 반환한다. */
 static struct frame *
 vm_get_frame(void)
 {
@@ -181,13 +203,16 @@ vm_get_frame(void)
 	if (kva == NULL) // page 할당 실패
 	{
 		struct frame *victim = vm_evict_frame();
-		victim->page = NULL;
+		if (victim != NULL)
+			victim->page = NULL;
 		return victim;
 	}
 
 	frame = (struct frame *)malloc(sizeof(struct frame)); // 프레임 할당
 	frame->kva = kva;									  // 프레임 멤버 초기화
 	frame->page = NULL;
+	frame->pinned = true;
+	frame->ref_cnt = 0;
 
 	lock_acquire(&frame_table_lock);
 	list_push_back(&frame_table, &frame->frame_elem);
@@ -273,14 +298,106 @@ bool vm_claim_page(void *va UNUSED)
 	return vm_do_claim_page(page);
 }
 
+/* heap과 anonymous mmap의 page는 처음 접근할 때 0으로 채운다. frame에는 이전 내용이 남아 있을 수 있다. */
+static bool
+anon_zero_fill(struct page *page, void *aux UNUSED)
+{
+	memset(page->frame->kva, 0, PGSIZE);
+	return true;
+}
+
+/* va부터 page_cnt개의 페이지에 0으로 채워질 anonymous page를 lazy하게 할당한다.
+ * 하나라도 실패하면 이미 만든 페이지를 되돌리고 false를 반환한다. */
+bool vm_alloc_anon(void *va, size_t page_cnt, bool writable)
+{
+	for (size_t i = 0; i < page_cnt; i++)
+		if (!vm_alloc_page_with_initializer(VM_ANON, va + i * PGSIZE, writable, anon_zero_fill, NULL))
+		{
+			vm_release_pages(va, i);
+			return false;
+		}
+	return true;
+}
+
+/* va부터 page_cnt개의 page를 spt에서 빼고 해제한다. 메모리에 올라와 있으면 매핑을 지우고
+ * frame은 빈 frame으로 돌려놓는다. 프로세스가 끝나기 전에 anonymous page를 돌려줄 때 쓴다. */
+void vm_release_pages(void *va, size_t page_cnt)
+{
+	struct thread *curr = thread_current();
+	for (size_t i = 0; i < page_cnt; i++, va += PGSIZE)
+	{
+		struct page *page = spt_find_page(&curr->spt, va);
+		if (page == NULL)
+			continue;
+		if (page->frame != NULL)
+		{
+			lock_acquire(&frame_table_lock);
+			page->frame->page = NULL;
+			page->frame->ref_cnt = 0;
+			lock_release(&frame_table_lock);
+			pml4_clear_page(curr->pml4, page->va);
+			page->frame = NULL;
+		}
+		spt_remove_page(&curr->spt, page);
+	}
+}
+
+/* Direct I/O를 위해 va가 속한 page를 메모리에 올리고 그 frame을 고정(pin)한다.
+ * 고정된 frame은 eviction 대상에서 제외되므로 디스크가 kva로 직접 읽고 써도 안전하다.
+ * write가 true이면 커널이 이 페이지에 쓸 것이므로 writable이어야 하고 dirty로 표시한다.
+ * 성공하면 frame의 kva를, spt에 없거나 권한이 없으면 NULL을 반환한다. */
+void *vm_pin_page(void *va, bool write)
+{
+	struct thread *curr = thread_current();
+	struct page *page = spt_find_page(&curr->spt, pg_round_down(va));
+	if (page == NULL || (write && !page->writable))
+		return NULL;
+
+	for (;;)
+	{
+		if (page->frame == NULL && !vm_do_claim_page(page))
+			return NULL;
+		// victim은 frame_table_lock 안에서 골라지고 바로 고정되므로, lock을 잡고 고정되지 않은 frame을 pin하면
+		// 더 이상 쫓겨나지 않는다.
+		lock_acquire(&frame_table_lock);
+		struct frame *frame = page->frame;
+		if (frame != NULL && !frame->pinned)
+		{
+			frame->pinned = true;
+			lock_release(&frame_table_lock);
+			if (write)
+				pml4_set_dirty(curr->pml4, page->va, true);
+			return frame->kva;
+		}
+		lock_release(&frame_table_lock);
+		// 그 사이 쫓겨났으면 다시 올리고, 쫓겨나는 중이면 끝날 때까지 양보한다.
+		if (frame != NULL)
+			thread_yield();
+	}
+}
+
+/* vm_pin_page()로 고정한 frame을 다시 eviction 대상으로 돌려놓는다. */
+void vm_unpin_page(void *va)
+{
+	struct page *page = spt_find_page(&thread_current()->spt, pg_round_down(va));
+	if (page == NULL || page->frame == NULL)
+		return;
+	lock_acquire(&frame_table_lock);
+	page->frame->pinned = false;
+	lock_release(&frame_table_lock);
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page(struct page *page)
 {
 	struct frame *frame = vm_get_frame();
+	if (frame == NULL)
+		return false;
 
 	/* Set links */
 	frame->page = page;
+	frame->ref_cnt = 1;
 	page->frame = frame;
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
@@ -288,7 +405,13 @@ vm_do_claim_page(struct page *page)
 	struct thread *current = thread_current();
 	pml4_set_page(current->pml4, page->va, frame->kva, page->writable);
 
-	return swap_in(page, frame->kva); // uninit_initialize
+	bool success = swap_in(page, frame->kva); // uninit_initialize
+
+	// 내용을 다 채운 뒤에야 eviction 대상이 된다.
+	lock_acquire(&frame_table_lock);
+	frame->pinned = false;
+	lock_release(&frame_table_lock);
+	return success;
 }
 
 /* Returns a hash value for page p. */
@@ -333,12 +456,26 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 		void *upage = src_page->va;
 		bool writable = src_page->writable;
 
+		/* 공유 메모리면 복사하지 않고 같은 페이지를 자식에게도 매핑한다. */
+		if (type == VM_SHM)
+		{
+			if (!shm_map_page(upage, src_page->shm.shm, src_page->shm.idx))
+				return false;
+			spt_find_page(dst, upage)->mapped_page_count = src_page->mapped_page_count;
+			continue;
+		}
+
 		/* 1) type이 uninit이면 */
 		if (type == VM_UNINIT)
 		{ // uninit page 생성 & 초기화
 			vm_initializer *init = src_page->uninit.init;
 			void *aux = src_page->uninit.aux;
-			vm_alloc_page_with_initializer(VM_ANON, upage, writable, init, aux);
+			segment_aux_hold(init, aux); // 실행 파일 세그먼트의 aux는 부모와 나눠 가진다.
+			if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, init, aux))
+			{
+				segment_aux_release(init, aux);
+				return false;
+			}
 			continue;
 		}
 